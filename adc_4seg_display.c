@@ -1,6 +1,10 @@
 #include <msp430.h> 
 #include <stdio.h>
 #include <stdlib.h>
+#include "lib/adc.h"
+#include "lib/digits.h"
+#include "lib/display.h"
+#include "lib/watchdog.h"
 
 /***************************************************************************
  * adc_4seg_display.c
@@ -9,22 +13,12 @@
  * Group 14: Michael Campo, Jeremie Tuzizila
  *
  * This code will enable an ADC to read voltage from a potentiometer.
- * A digit of the sampled value between 0-1023 will be shown on a 7-segment
+ * A digit of the sampled value between 0-ADC_MAX will be shown on a 7-segment
  * display dependent on the read voltage value in its proper digit place. :)
  *
  ***************************************************************************/
 
-/* Define 7-seg to hex values, use not operator if display is common anode*/
-#define ZERO    (~0x7E)
-#define ONE     (~0x30)
-#define TWO     (~0x6D)
-#define THREE   (~0x79)
-#define FOUR    (~0x33)
-#define FIVE    (~0x5B)
-#define SIX     (~0x5F)
-#define SEVEN   (~0x70)
-#define EIGHT   (~0x7F)
-#define NINE    (~0x7B)
+#define BEAT_LOOP   BIT0            // watchdog heartbeat, sampled and displayed
 
 /* Global variables */
 unsigned int first=0, second=0, third=0, fourth=0, oldVal=0;
@@ -34,7 +28,6 @@ void portInit(void);
 int sampleADC(int);
 int getKey(int);
 void display(int);
-void displayDigit(int);
 
 int main(void)
 {
@@ -45,6 +38,8 @@ int main(void)
         int keyVal = getKey(readVal);
         display(keyVal);
         oldVal = readVal;
+        HEARTBEAT(BEAT_LOOP);
+        supervise(BEAT_LOOP);
         __delay_cycles(10000);
     }
 
@@ -68,50 +63,37 @@ void portInit(void)
     ADC10CTL1 = INCH_5 + ADC10DIV_3;        // select channel A5, ADC10CLK/3
     ADC10CTL0 = ADC10SHT_3 + MSC + ADC10ON; // sample/hold 64 cycle, multiple sample, turn on ADC10
     ADC10AE0 |= BIT5;                       // enable P1.5 for analog input
+
+    watchdogStart();                        // supervised from here on
 }
 
 /*
  * Function:  sampleADC
  * ----------------------
  * Enables and starts ADC conversion.
- * Return sampled value from ADC10MEM Register.
+ * Sums ADC_SAMPLES conversions from ADC10MEM Register and decimates
+ * the sum down to ADC_RES_BITS of resolution.
  *
- * returns: int value between 0-1023
+ * returns: int value between 0-ADC_MAX
  */
 
 int sampleADC(int oldVal)
 {
-    unsigned int sum = 0;
-    unsigned int i = 0;
-
-    //__delay_cycles(1000);
-    for (i=0; i<32; i++){                               // sample the ADC value 32 times
-        ADC10CTL0 |= ENC + ADC10SC;                     // enable and start conversion
-        while ( (ADC10CTL1 & ADC10BUSY) == 0x01);       // wait until sample operation is complete
-        sum += ADC10MEM;
-    }
-
-
-    if (sum == 0){return 0;}
+    unsigned int read = adcOversample();                // oversample the ADC value
 
-    unsigned int read = (sum/32)+1;                     // take the average sampled value
+    if (read == 0){return 0;}
 
-    if (read == 1024){return 1023;}                     // fix top edge condition created by sampled rounding
+    read++;                                             // sampled rounding
+    if (read > ADC_MAX){return ADC_MAX;}                // fix top edge condition created by sampled rounding
 
-    int difference = abs(read-oldVal);                  // find the difference between the newly sampled value and previous value
-
-    if (difference < 2){                                // if difference less than 2, return old value to help prevent oscillating
-        return oldVal;
-    }
-
-    return read;
+    return adcHold(read, oldVal, ADC_COUNTS(2));        // if difference less than 2 10-bit counts, return old value to help prevent oscillating
 }
 
 /*
  * Function:  getKey
  * ----------------------
  * Receives the sampled ADC value and splits it
- * into digit places using modulo division.
+ * into digit places with splitDigits.
  * Based off position place a key is created
  *
  * returns: key used for digit places activated
@@ -119,32 +101,13 @@ int sampleADC(int oldVal)
 
 int getKey(int readVal)
 {
-    unsigned int key=0;
-
-    if (readVal > 999){
-        key = 4;
-    }
-    else if (readVal > 99){
-        key = 3;
-    }
-    else if (readVal > 10){
-        key = 2;
-    }
-    else {
-        key = 1;
-    }
-
-
-    first = readVal % 10;
-    readVal /= 10;
+    unsigned char place[DIGIT_COUNT];
+    unsigned int key = splitDigits(readVal, place);
 
-    second = readVal % 10;
-    readVal /= 10;
-
-    third = readVal % 10;
-    readVal /= 10;
-
-    fourth =  readVal % 10;
+    first = place[0];
+    second = place[1];
+    third = place[2];
+    fourth = place[3];
 
     return key;
 }
@@ -207,59 +170,3 @@ void display(int keyVal)
     }
 }
 
-/*
- * Function: displayDigit
- * --------------------
- * Based on the passed int value, assign output port P2.0-P2.6
- * to display the corresponding number
- *
- * returns: void
- */
-
-void displayDigit(int val)
-{
-    switch(val) {
-    case 0:
-        P2OUT = ZERO;
-        break;
-
-    case 1:
-        P2OUT = ONE;
-        break;
-
-    case 2:
-        P2OUT = TWO;
-        break;
-
-    case 3:
-        P2OUT = THREE;
-        break;
-
-    case 4:
-        P2OUT = FOUR;
-        break;
-
-    case 5:
-        P2OUT = FIVE;
-        break;
-
-    case 6:
-        P2OUT = SIX;
-        break;
-
-    case 7:
-        P2OUT = SEVEN;
-        break;
-
-    case 8:
-        P2OUT = EIGHT;
-        break;
-
-    case 9:
-        P2OUT = NINE;
-        break;
-
-    default:
-        P2OUT = ~0x00;
-    }
-}
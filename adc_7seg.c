@@ -9,8 +9,16 @@
  */
 
 #include <msp430.h>
+#include "lib/watchdog.h"
+
+#define BAND_SHIFT  6                   // 1024 ADC codes / 16 hex levels = 64 codes per band
+#define BAND_MASK   0x3F                // position of the ADC code inside its band
+#define BAND_GAP    62                  // 2 point upper buffer at the top of each band
+#define BEAT_LOOP   BIT0                // watchdog heartbeat, sampled and displayed
 
 /* Global variables */
+static const char HexChar[16] = {'0','1','2','3','4','5','6','7',
+                                 '8','9','a','b','c','d','e','f'};
 char val = '0';
 unsigned int ADC_Read = 0;
 
@@ -30,11 +38,13 @@ void main(void)
     ADC10CTL1 = INCH_2 + ADC10DIV_3;        // select channel A2, ADC10CLK/3
     ADC10CTL0 = ADC10SHT_3 + MSC + ADC10ON; // sample/hold 64 cycle, multiple sample, turn on ADC10
     ADC10AE0 |= BIT2;                       // enable P1.2 for analog input
-
+    watchdogStart();                        // supervised from here on
 
     while(1){
         char ADC_value = ADC_sample();
         display_7seg(ADC_value);
+        HEARTBEAT(BEAT_LOOP);
+        supervise(BEAT_LOOP);
     }
 
 }
@@ -43,7 +53,7 @@ void main(void)
  * Function:  ADC_sample
  * ----------------------
  * Enables and starts ADC conversion. Extrapolate hex value based on
- * ADC value from ADC10MEM Register.
+ * ADC value from ADC10MEM Register in constant time using a shift.
  *
  * returns: Character of hex number 0-F
  */
@@ -54,58 +64,11 @@ char ADC_sample(void)
     while ( (ADC10CTL1 & ADC10BUSY) == 0x01);       // wait until sample operation is complete
     ADC_Read = ADC10MEM;                            // ADC_Read from ADC register
 
-    /* use if-else statements to determine character
-     * values with a 2 point upper buffer */
-    if (ADC_Read <62){
-            val = '0';
-    }
-    else if ((ADC_Read >=64) && (ADC_Read < 126)){
-            val = '1';
-        }
-    else if ((ADC_Read >=128) && (ADC_Read < 190)){
-            val = '2';
-        }
-    else if ((ADC_Read >=192) && (ADC_Read < 254)){
-            val = '3';
-        }
-    else if ((ADC_Read >=256) && (ADC_Read < 318)){
-            val = '4';
-        }
-    else if ((ADC_Read >=320) && (ADC_Read < 382)){
-            val = '5';
-        }
-    else if ((ADC_Read >=384) && (ADC_Read < 446)){
-            val = '6';
-        }
-    else if ((ADC_Read >=448) && (ADC_Read < 510)){
-            val = '7';
-        }
-    else if ((ADC_Read >=512) && (ADC_Read < 574)){
-            val = '8';
-        }
-    else if ((ADC_Read >=576) && (ADC_Read < 638)){
-            val = '9';
-        }
-    else if ((ADC_Read >=640) && (ADC_Read < 702)){
-            val = 'a';
-        }
-    else if ((ADC_Read >=704) && (ADC_Read < 766)){
-            val = 'b';
-        }
-    else if ((ADC_Read >=768) && (ADC_Read < 830)){
-            val = 'c';
-        }
-    else if ((ADC_Read >=832) && (ADC_Read < 894)){
-            val = 'd';
-        }
-    else if ((ADC_Read >=896) && (ADC_Read < 958)){
-            val = 'e';
-        }
-    else if (ADC_Read >=960){
-            val = 'f';
-        }
-    else {
-        val = val;
+    /* quantize to one of 16 bands of 64 codes, the top 2 codes of
+     * each band act as a buffer that keeps the previous value */
+    unsigned int band = ADC_Read >> BAND_SHIFT;
+    if (((ADC_Read & BAND_MASK) < BAND_GAP) || (band == 0x0F)){
+        val = HexChar[band];
     }
 
     return val;
@@ -1,6 +1,11 @@
 #include <msp430.h> 
 #include <stdio.h>
 #include <stdlib.h>
+#include "lib/digits.h"
+#include "lib/display.h"
+#include "lib/flash.h"
+#include "lib/gravity.h"
+#include "lib/watchdog.h"
 
 /***************************************************************************
  * adc_accelerometer.c
@@ -12,65 +17,128 @@
  * The value of this will either be displayed as raw sampled from the ADC
  * or it will be converted into a gravity value in accordance to the
  * accelerometer sensitivity. A button can be pressed to switch between modes.
+ * Holding the button during reset starts a six position calibration whose
+ * per-axis offsets and gains are kept in information memory.
  *
  ***************************************************************************/
 
-/* Define 7-seg to hex values, use not operator if display is common anode*/
-#define ZERO    (~0x7E)
-#define ONE     (~0x30)
-#define TWO     (~0x6D)
-#define THREE   (~0x79)
-#define FOUR    (~0x33)
-#define FIVE    (~0x5B)
-#define SIX     (~0x5F)
-#define SEVEN   (~0x70)
-#define EIGHT   (~0x7F)
-#define NINE    (~0x7B)
-#define DP      (~BIT7)
+/* 7-seg values beyond the digits in lib/display.c, use not operator if display is common anode*/
+#define DP      ((unsigned char) ~BIT7)
 #define MINUS   (~0x01)
 #define X_AXIS  (~0x37)
 #define Y_AXIS  (~0x3B)
 #define MEDIAN  479                 // zero bias value for accelerometer
+#define G_COUNTS    95              // default counts per 1 g (9-10 counts per 0.1 g)
 #define TIMER_DELAY_MS  3000        // 3s delay time
+#define VLO_HZ      12000UL         // nominal VLO frequency clocking ACLK
+#define AXIS_TICKS  ((VLO_HZ / 8) * TIMER_DELAY_MS / 1000)  // ACLK/8 counts per axis rotation
+#define BEAT_SAMPLE BIT0            // watchdog heartbeat, axes sampled
+
+/* Button debouncer driven by Timer_A CCR1 */
+#define BTN_MODE        BIT3        // P1.3 switches display mode, long press calibrates
+#define BTN_MASK        BTN_MODE
+#define BTN_COUNT       1
+#define DEBOUNCE_TICKS  8           // ~5ms sample period at ACLK/8
+#define DEBOUNCE_MAX    4           // integrator saturates after ~20ms of stable input
+#define LONG_TICKS      190         // ~1s hold reports a long press
+#define REPEAT_TICKS    47          // then repeats every ~250ms while held
+#define EVENT_QUEUE_SIZE 8          // power of two
+
+/* Accelerometer calibration kept in information memory */
+#define CAL_MAGIC       0xCA1B
+#define CAL_STEPS       6           // +X, -X, +Y, -Y, +Z, -Z facing up
+#define CAL_MIN_GAIN    20          // reject captures with less spread than this
+#define CAL_SEG_B       ((const struct Calibration *) INFO_SEG(INFO_B))
+#define CAL_SEG_C       ((const struct Calibration *) INFO_SEG(INFO_C))
+#define CAL_WORDS       (sizeof(struct Calibration) / sizeof(unsigned int))
 
 /* Global variables */
-unsigned int first=0, second=0, third=0, fourth=0, old_val=0;
+unsigned int first=0, second=0, third=0, fourth=0;
 unsigned int adc_samples[8];
-unsigned int Axis = 0;              // X=0, Y=1, Z=2
-unsigned int TCount = 0;
+unsigned int AxisVal[3];            // latest sampled value of each axis
+volatile unsigned int Axis = 0;     // displayed axis X=0, Y=1, Z=2
 unsigned int DisplayState = 0;      // picks state A=0, B=1
 
+struct Calibration {
+    unsigned int magic;
+    unsigned int count;             // number of saves, newest valid copy wins
+    int offset[3];                  // zero g reading per axis
+    int gain[3];                    // counts per 1 g per axis
+    unsigned int checksum;
+};
+struct Calibration Cal = {CAL_MAGIC, 0, {MEDIAN, MEDIAN, MEDIAN}, {G_COUNTS, G_COUNTS, G_COUNTS}, 0};
+const struct Calibration *CalSegment = CAL_SEG_C;  // segment holding the active copy
+int CalCapture[CAL_STEPS][3];
+unsigned int CalStep = 0;           // positions captured so far
+unsigned int CalMode = 0;           // set by a long press or the button held during reset
+unsigned int GravityScale[3];       // Q8 milli-g per ADC count, per axis
+
+enum Events {EV_NONE, EV_PRESS, EV_LONG, EV_REPEAT};
+struct Button {
+    unsigned char pin;              // port 1 bit
+    unsigned char integrator;       // 0 = released, DEBOUNCE_MAX = pressed
+    unsigned char held;             // 0 = released, 1 = press reported, 2 = long press reported
+    unsigned int ticks;             // ticks until next long press or repeat event
+};
+struct Button Buttons[BTN_COUNT] = {{BTN_MODE, 0, 0, 0}};
+volatile unsigned char EventQueue[EVENT_QUEUE_SIZE];    // (button << 2) | event
+volatile unsigned int EventHead = 0, EventTail = 0;
+
 /* Function Prototypes */
 void portInit(void);
 void timerInit(void);
-int sampleADC(int,int);
+void sampleAxes(void);
 int getKey(int);
-int getGravity(int);
+int getGravity(int,int);
+void setGravityScale(void);
 void display_A(int,int);
 void display_B(int,int);
-void displayDigit(int);
+unsigned int calChecksum(const struct Calibration*);
+void calLoad(void);
+void calSave(void);
+void calCapture(void);
+void postEvent(unsigned char);
+unsigned char getEvent(void);
+unsigned int debounce(void);
+void handleButtons(void);
 
 int main(void)
 {
     portInit();             // initialize ports
     timerInit();            // initialize timer
+    watchdogStart();        // supervised from here on
+    calLoad();              // restore accelerometer calibration
+    setGravityScale();
+    if ((P1IN & BIT3) == 0){
+        CalMode = 1;        // button held during reset, run calibration
+    }
     _enable_interrupt();
-    TACCR0 = 1000 - 1;      // start timer
 
     while(1){
-        int read_val = sampleADC(old_val, Axis);        // sample ADC value from accelerometer
+        sampleAxes();                                   // sample X, Y and Z together
+        HEARTBEAT(BEAT_SAMPLE);
+        handleButtons();                                // act on debounced button events
+        supervise(BEAT_SAMPLE);
+
+        if (CalMode){
+            display_A(getKey(CalStep), Axis);           // show number of captured positions
+            __delay_cycles(1000);
+            continue;
+        }
+
+        int axis = Axis;                                // axis selected by the timer
+        int read_val = AxisVal[axis];                   // current value of displayed axis
 
         if (~DisplayState) {                            // DisplayState acts as flag to determine display mode
             int keyVal = getKey(read_val);              // split raw ADC into values place
-            display_A(keyVal, Axis);                    // display raw ADC value
+            display_A(keyVal, axis);                    // display raw ADC value
 
         }
         else{
-            int gravity_val = getGravity(read_val);     // convert raw ADC to gravity value
-            display_B(gravity_val, Axis);               // display axis and gravity value
+            int gravity_val = getGravity(read_val, axis);   // convert raw ADC to gravity value
+            display_B(gravity_val, axis);               // display axis and gravity value
         }
 
-        old_val = read_val;                             // store current value for comparison
         __delay_cycles(1000);
     }
 
@@ -98,10 +166,10 @@ void portInit(void)
     ADC10DTC1 = 7;                              // transfer block is 7 wide
 
     /*  Configure Button as interrupt  */
-    P1REN |= BIT3;
-    P1OUT |= BIT3;
-    P1IE |= BIT3;
-    P1IES &= ~(BIT3);
+    P1REN |= BTN_MODE;
+    P1OUT |= BTN_MODE;
+    P1IE |= BTN_MODE;
+    P1IES |= BTN_MODE;                      // falling edge on press
     P1IFG = 0x00;                           // clear interrupt flags
 }
 
@@ -114,80 +182,267 @@ void portInit(void)
 void timerInit(void)
 {
     /* Configure Timer */
-    TACCR0 = 0;                         // Initially, stop the timer
+    BCSCTL3 |= LFXT1S_2;                // ACLK from VLO, XIN/XOUT are used as GPIO
+    TACCR0 = AXIS_TICKS;                // first axis rotation
     TACCTL0 |= CCIE;                    // Enable interrupt for CCR0
-    TACTL = TASSEL_2 + ID_0 + MC_1;     // Select SMCLK, SMCLK/1, Up Mode
+    TACTL = TASSEL_1 + ID_3 + MC_2;     // Select ACLK, ACLK/8, Continuous Mode
+}
+
+
+/*
+ * Function:    calChecksum
+ * ---------------------
+ * Returns the one's complement of the sum of every calibration word
+ * ahead of the checksum field.
+ */
+unsigned int calChecksum(const struct Calibration *cal)
+{
+    return flashChecksum(cal, CAL_WORDS - 1);
+}
+
+/*
+ * Function:    calLoad
+ * ---------------------
+ * Loads the newest valid calibration copy from information memory
+ * segments B and C. The compiled in defaults stay active when
+ * neither copy passes the magic and checksum test.
+ */
+void calLoad(void)
+{
+    const struct Calibration *seg[2] = {CAL_SEG_B, CAL_SEG_C};
+    const struct Calibration *best = 0;
+    unsigned int i;
+
+    for (i=0; i<2; i++){
+        if ((seg[i]->magic == CAL_MAGIC) && (seg[i]->checksum == calChecksum(seg[i]))){
+            if ((best == 0) || ((int)(seg[i]->count - best->count) > 0)){
+                best = seg[i];
+            }
+        }
+    }
+
+    if (best != 0){
+        Cal = *best;
+        CalSegment = best;
+    }
 }
 
+/*
+ * Function:    calSave
+ * ---------------------
+ * Writes the calibration into the segment not holding the active copy,
+ * so both segments wear evenly and the old copy survives a power loss
+ * part way through the erase or write.
+ */
+void calSave(void)
+{
+    unsigned int *dst;
+
+    dst = (unsigned int *)((CalSegment == CAL_SEG_B) ? CAL_SEG_C : CAL_SEG_B);
+    Cal.magic = CAL_MAGIC;
+    Cal.count++;
+    Cal.checksum = calChecksum(&Cal);
+    flashWrite(dst, &Cal, CAL_WORDS);
+
+    CalSegment = (const struct Calibration *)dst;
+}
 
 /*
- * Function:  sampleADC
+ * Function:    calCapture
+ * ---------------------
+ * Stores all three axes for the next of the six calibration positions
+ * (+X, -X, +Y, -Y, +Z, -Z facing up). After the last position the offset
+ * and gain of each axis are taken from its up and down readings, saved
+ * to flash and the normal display modes resume.
+ */
+void calCapture(void)
+{
+    int offset[3], gain[3];
+    unsigned int i;
+
+    for (i=0; i<3; i++){
+        CalCapture[CalStep][i] = AxisVal[i];
+    }
+    CalStep++;
+
+    if (CalStep < CAL_STEPS){return;}
+    CalStep = 0;
+    CalMode = 0;
+
+    for (i=0; i<3; i++){
+        int up = CalCapture[2*i][i];
+        int down = CalCapture[2*i+1][i];
+
+        offset[i] = (up + down)/2;
+        gain[i] = abs(up - down)/2;
+        if (gain[i] < CAL_MIN_GAIN){return;}           // bad capture, keep the active calibration
+    }
+
+    for (i=0; i<3; i++){
+        Cal.offset[i] = offset[i];
+        Cal.gain[i] = gain[i];
+    }
+    setGravityScale();
+    calSave();
+}
+
+/*
+ * Function:  postEvent
  * ----------------------
- * Enables and starts ADC conversion.
- * Return sampled value from ADC10MEM Register.
+ * Adds a button event to the queue, dropping it when the queue is full.
+ */
+void postEvent(unsigned char event)
+{
+    unsigned int next = (EventHead + 1) & (EVENT_QUEUE_SIZE - 1);
+
+    if (next != EventTail){
+        EventQueue[EventHead] = event;
+        EventHead = next;
+    }
+}
+
+/*
+ * Function:  getEvent
+ * ----------------------
+ * Removes the oldest button event from the queue.
  *
- * returns: int value between 0-1023
+ * returns: (button << 2) | event, EV_NONE when the queue is empty
  */
-int sampleADC(int oldVal, int Axis)
+unsigned char getEvent(void)
 {
-    unsigned int sum = 0;
+    unsigned char event;
+
+    if (EventTail == EventHead){return EV_NONE;}
+    event = EventQueue[EventTail];
+    EventTail = (EventTail + 1) & (EVENT_QUEUE_SIZE - 1);
+    return event;
+}
+
+/*
+ * Function:  debounce
+ * ----------------------
+ * Runs once per debounce tick. Integrates the level of each button and
+ * posts press, long press and repeat events on stable transitions.
+ *
+ * returns: number of buttons still pressed or settling
+ */
+unsigned int debounce(void)
+{
+    unsigned int active = 0;
+    unsigned int i;
+
+    for (i=0; i<BTN_COUNT; i++){
+        struct Button *btn = &Buttons[i];
+
+        if ((P1IN & btn->pin) == 0){                    // pressed, pull-up reads low
+            if (btn->integrator < DEBOUNCE_MAX){btn->integrator++;}
+        }
+        else if (btn->integrator > 0){
+            btn->integrator--;
+        }
+
+        if (btn->held){
+            if (btn->integrator == 0){
+                btn->held = 0;                          // release
+            }
+            else if (--btn->ticks == 0){
+                postEvent((i << 2) | ((btn->held == 1) ? EV_LONG : EV_REPEAT));
+                btn->held = 2;
+                btn->ticks = REPEAT_TICKS;
+            }
+        }
+        else if (btn->integrator == DEBOUNCE_MAX){
+            btn->held = 1;
+            btn->ticks = LONG_TICKS;
+            postEvent((i << 2) | EV_PRESS);
+        }
+
+        if (btn->integrator > 0){active++;}
+    }
+    return active;
+}
+
+/*
+ * Function:  handleButtons
+ * ----------------------
+ * Applies every queued button event. A press switches the display mode
+ * or captures the next calibration position, a long press starts a
+ * new calibration.
+ */
+void handleButtons(void)
+{
+    unsigned char event;
+
+    while ((event = getEvent()) != EV_NONE){
+        switch (event & 0x03){
+        case EV_PRESS:
+            if (CalMode){
+                calCapture();                           // capture position on each button press
+            }
+            else{
+                DisplayState = ~(DisplayState);
+            }
+            break;
+        case EV_LONG:
+            CalMode = 1;
+            CalStep = 0;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/*
+ * Function:  sampleAxes
+ * ----------------------
+ * Enables and starts ADC conversion of the X, Y and Z channels.
+ * Averages 32 block transfers and updates the value of every axis
+ * that moved by 2 or more, so all three axes are always current.
+ */
+void sampleAxes(void)
+{
+    unsigned int sum[3] = {0, 0, 0};
     unsigned int i = 0;
 
-    for (i=0; i<32; i++){                               // sample the ADC value 32 times
+    for (i=0; i<32; i++){                               // sample the ADC values 32 times
         ADC10CTL0 |= ENC + ADC10SC;                     // enable and start conversion
         while ( (ADC10CTL1 & ADC10BUSY) == 0x01);       // wait until sample operation is complete
         ADC10SA = (unsigned int)adc_samples;            // send values to sample array
-        sum += adc_samples[Axis];
+        sum[0] += adc_samples[0];
+        sum[1] += adc_samples[1];
+        sum[2] += adc_samples[2];
     }
 
-    if (sum == 0){return 0;}
-    unsigned int read = (sum/32)+1;                     // take the average sampled value
-    if (read == 1024){return 1023;}                     // fix top edge condition created by sampled rounding
-    int difference = abs(read-old_val);                  // find the difference between the newly sampled value and previous value
-    if (difference < 2){                                // if difference less than 2, return old value to help prevent oscillating
-        return old_val;
+    for (i=0; i<3; i++){
+        unsigned int read = (sum[i]/32)+1;              // take the average sampled value
+        if (sum[i] == 0){read = 0;}
+        if (read == 1024){read = 1023;}                 // fix top edge condition created by sampled rounding
+        unsigned int difference = (read > AxisVal[i]) ? read - AxisVal[i] : AxisVal[i] - read; // change from the previous value, either way
+        if (difference >= 2){                           // if difference less than 2, keep old value to help prevent oscillating
+            AxisVal[i] = read;
+        }
     }
-
-    return read;
 }
 
 /*
  * Function:  getKey
  * ----------------------
  * Receives the sampled ADC value and splits it
- * into digit places using modulo division.
+ * into digit places with splitDigits.
  * Based off position place a key is created
  *
  * returns: key used for digit places activated
  */
 int getKey(int read_val)
 {
-    unsigned int key=0;
+    unsigned char place[DIGIT_COUNT];
+    unsigned int key = splitDigits(read_val, place);
 
-    if (read_val > 999){
-        key = 4;
-    }
-    else if (read_val > 99){
-        key = 3;
-    }
-    else if (read_val > 10){
-        key = 2;
-    }
-    else {
-        key = 1;
-    }
-
-
-    first = read_val % 10;
-    read_val /= 10;
-
-    second = read_val % 10;
-    read_val /= 10;
-
-    third = read_val % 10;
-    read_val /= 10;
-
-    fourth =  read_val % 10;
+    first = place[0];
+    second = place[1];
+    third = place[2];
+    fourth = place[3];
 
     return key;
 }
@@ -195,45 +450,30 @@ int getKey(int read_val)
 /*
  * Function:  getGravity
  * ----------------------
- * Receives the sampled ADC value and normalizes
- * the value into a range between -3 and +3.
+ * Receives the sampled ADC value and converts the offset from the
+ * calibrated zero point into gravity with one multiply by the Q8
+ * sensitivity of the given axis, see gravityMilli().
  *
- * returns: 0 for negative and 1 for positive
+ * returns: signed gravity value in milli-g, clamped to +-GRAVITY_MAX
  */
-int getGravity(int readVal)
+int getGravity(int readVal, int Axis)
 {
-    unsigned int target = MEDIAN;
-    unsigned int count = 0;
-
-    if ((readVal > MEDIAN-4) && (readVal < MEDIAN+4)){                    // Middle place 0
-        first = 0;
-        second = 0;
-        return 1;
-    }
+    return gravityMilli(readVal - Cal.offset[Axis], GravityScale[Axis]);
+}
 
-    else if (readVal < MEDIAN){                             // Find negative value
-        while((target > readVal) && (target > 2)){          // Continue incrementing down until target is less than ADC value
-            target -= 9;                                    // Range of 17 values per 0.1
-            count++;
-        }
-        first = count % 10;
-        count /= 10;
-        second = count % 10;
-        return 0;
-    }
+/*
+ * Function:  setGravityScale
+ * ----------------------
+ * Computes the Q8 milli-g per count sensitivity of each axis from the
+ * calibrated gain, so getGravity() never divides.
+ */
+void setGravityScale(void)
+{
+    unsigned int i;
 
-    else if (readVal > MEDIAN){                     // Find positive value
-        while((target < readVal) && (target < 1022)){
-            target += 10;
-            count++;
-        }
-        first = count % 10;
-        count /= 10;
-        second = count % 10;
-        return 1;
+    for (i=0; i<3; i++){
+        GravityScale[i] = gravityScale(Cal.gain[i]);
     }
-
-    return 0;
 }
 
 /*
@@ -324,15 +564,20 @@ void display_A(int keyVal, int Axis)
  * Function:  display_B
  * ----------------------
  * This function is used to display the gravity values
- * as required by part B of the lab.
+ * in milli-g as required by part B of the lab.
  *
  */
 void display_B(int gravity_val, int Axis)
 {
     unsigned int sign = 0xFF;       // create sign flag with value
-    if (gravity_val == 0){          // if gravity flag is negative (0), display MINUS sign
+    if (gravity_val < 0){           // if gravity value is negative, display MINUS sign
         sign = MINUS;
+        gravity_val = -gravity_val;
     }
+    unsigned int tenths = (gravity_val + 50)/100;   // round milli-g to tenths of g
+    if (tenths > 99){tenths = 99;}                  // two places, GRAVITY_MAX shows 9.9
+    first = tenths % 10;
+    second = (tenths/10) % 10;
     P1OUT &= BIT3;
 
     switch(Axis){
@@ -387,7 +632,7 @@ void display_B(int gravity_val, int Axis)
         __delay_cycles(2000);
         P1OUT ^= BIT1;
         P1OUT |= BIT0;
-        P2OUT = TWO;                // Use 2 for Z-axis display
+        displayDigit(2);            // Use 2 for Z-axis display
         break;
 
     default:
@@ -395,70 +640,36 @@ void display_B(int gravity_val, int Axis)
     }
 }
 
-/*
- * Function: displayDigit
- * --------------------
- * Based on the passed int value, assign output port P2.0-P2.6
- * to display the corresponding number
- *
- * returns: void
- */
-
-void displayDigit(int val)
-{
-    switch(val) {
-    case 0:
-        P2OUT = ZERO;
-        break;
-    case 1:
-        P2OUT = ONE;
-        break;
-    case 2:
-        P2OUT = TWO;
-        break;
-    case 3:
-        P2OUT = THREE;
-        break;
-    case 4:
-        P2OUT = FOUR;
-        break;
-    case 5:
-        P2OUT = FIVE;
-        break;
-    case 6:
-        P2OUT = SIX;
-        break;
-    case 7:
-        P2OUT = SEVEN;
-        break;
-    case 8:
-        P2OUT = EIGHT;
-        break;
-    case 9:
-        P2OUT = NINE;
-        break;
-    default:
-        P2OUT = ~0x00;
-    }
-}
-
 // Interrupts
 
 //Timer ISR
 #pragma vector = TIMER0_A0_VECTOR
 __interrupt void Timer_A_CCR0_ISR(void) {
-    TCount++;
-    if (TCount >= TIMER_DELAY_MS){
-        if(Axis == 2){Axis = 0;}
-        else{Axis++;}
-        TCount = 0;                 // reset count value
+    TACCR0 += AXIS_TICKS;           // one compare per axis rotation
+    if(Axis == 2){Axis = 0;}
+    else{Axis++;}
+}
+// Timer CCR1 ISR, debounce tick
+#pragma vector = TIMER0_A1_VECTOR
+__interrupt void Timer_A_CCR1_ISR(void) {
+    switch(TAIV){
+    case TA0IV_TACCR1:
+        TACCR1 += DEBOUNCE_TICKS;   // next debounce tick
+        if (debounce() == 0){       // all buttons released, back to edge interrupts
+            TACCTL1 &= ~CCIE;
+            P1IFG &= ~BTN_MASK;
+            P1IE |= BTN_MASK;
+        }
+        break;
+    default:
+        break;
     }
 }
-// Port 1 ISR
+// Port 1 ISR, hands the button over to the debounce tick
 #pragma vector = PORT1_VECTOR
 __interrupt void PORT1_ISR(void) {
-    DisplayState = ~(DisplayState);
-    __delay_cycles(10000);
-    P1IFG &= ~BIT3;                     // clear P1.3 interrupt flag
+    P1IE &= ~BTN_MASK;                  // ignore bounces while debouncing
+    P1IFG &= ~BTN_MASK;                 // clear P1.3 interrupt flag
+    TACCR1 = TAR + DEBOUNCE_TICKS;
+    TACCTL1 = CCIE;                     // start the debounce tick
 }
-
@@ -1,4 +1,4 @@
-#include <msp430.h>				
+#include <msp430.h>
 /**
  * blink_LED.c
  * ECGR 5431: Lab 2
@@ -6,23 +6,81 @@
  *
  * This code will blink an LED for 1 second unless the button is pressed
  * which will keep the LED in its current state. :P
+ *
+ * Everything runs from interrupts: Timer_A CCR0 toggles the LED every
+ * BLINK_MS, a P1.1 edge hands the button to a one-shot CCR1 debounce,
+ * and the CPU sleeps in LPM3 with ACLK from the VLO in between.
  */
+
+#define LED         BIT4            // P1.4
+#define BUTTON      BIT1            // P1.1, low holds the LED
+#define VLO_HZ      12000UL         // nominal VLO frequency clocking ACLK
+#define BLINK_MS    1000            // LED toggle period
+#define DEBOUNCE_MS 20              // button must be stable this long
+#define BLINK_TICKS     (VLO_HZ * BLINK_MS / 1000)
+#define DEBOUNCE_TICKS  (VLO_HZ * DEBOUNCE_MS / 1000)
+
+#if BLINK_TICKS > 0xFFFF || BLINK_TICKS < 1
+#error "BLINK_MS must fit one 16-bit Timer_A compare at VLO_HZ"
+#endif
+
+volatile unsigned char Paused = 0;  // button held, LED keeps its state
+
 void main(void)
 {
 	WDTCTL = WDTPW | WDTHOLD;		// stop watchdog timer
-	P1DIR |= BIT4;                  // configure P1.4 as output
-    P1OUT |= BIT4;                  // enable led
-
-    volatile unsigned short read = 0;
-
-	while(1)
-	{
-	    read = BIT1 & P1IN;         // read value of button on P1.1
-	    if (read == BIT1){
-	        P1OUT ^= BIT4;          // provide output to led
-	    }
-	    __delay_cycles(1000000);    // delay for 1 second
+	BCSCTL3 |= LFXT1S_2;            // ACLK from VLO, XIN/XOUT are used as GPIO
+	P1OUT = LED;                    // enable led
+	P1DIR = 0xFF - BUTTON;          // unused pins driven low, P1.1 input
+	P2OUT = 0x00;
+	P2DIR = 0xFF;
+	P2SEL = 0x00;                   // XIN/XOUT as GPIO
+	P2SEL2 = 0x00;
+
+	Paused = !(P1IN & BUTTON);
+	if (Paused){P1IES &= ~BUTTON;}  // wait for release
+	else{P1IES |= BUTTON;}          // wait for press
+	P1IFG &= ~BUTTON;
+	P1IE |= BUTTON;
+
+	TACCR0 = BLINK_TICKS;
+	TACCTL0 = CCIE;
+	TACTL = TASSEL_1 + MC_2;        // ACLK, continuous mode
+
+	__bis_SR_register(LPM3_bits + GIE);     // nothing left for main, ISRs do the work
+}
+
+// Timer CCR0 ISR, blink tick
+#pragma vector = TIMER0_A0_VECTOR
+__interrupt void Timer_A_CCR0_ISR(void) {
+	TACCR0 += BLINK_TICKS;          // next toggle, no drift from ISR latency
+	if (!Paused){
+	    P1OUT ^= LED;               // provide output to led
 	}
 }
 
+// Timer CCR1 ISR, button has settled
+#pragma vector = TIMER0_A1_VECTOR
+__interrupt void Timer_A_CCR1_ISR(void) {
+	switch(TAIV){
+	case TA0IV_TACCR1:
+	    TACCTL1 = 0;
+	    Paused = !(P1IN & BUTTON);
+	    if (Paused){P1IES &= ~BUTTON;}
+	    else{P1IES |= BUTTON;}
+	    P1IFG &= ~BUTTON;           // changing P1IES may set the flag
+	    P1IE |= BUTTON;
+	    break;
+	default:
+	    break;
+	}
+}
 
+// Port 1 ISR, hands the button over to the debounce compare
+#pragma vector = PORT1_VECTOR
+__interrupt void PORT1_ISR(void) {
+	P1IE &= ~BUTTON;                // ignore bounces while debouncing
+	P1IFG &= ~BUTTON;
+	TACCR1 = TAR + DEBOUNCE_TICKS;
+	TACCTL1 = CCIE;
+}
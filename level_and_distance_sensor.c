@@ -2,6 +2,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include "lib/board.h"
+#include "lib/digits.h"
+#include "lib/flash.h"
+#include "lib/frame.h"
+#include "lib/gravity.h"
+#include "lib/link.h"
+#include "lib/uart.h"
+#include "lib/watchdog.h"
 
 /***************************************************************************
  * adc_ultrasonic_sensor.c
@@ -14,18 +22,12 @@
  * distance is also sent to secondary MCU via UART to display the value on
  * the LED display. When in level mode, the accelerometer measures the angle
  * in the X and Y axis directions and displays the value on the LED.
+ * Pressing the preset button in level mode steps through a six position
+ * accelerometer calibration that is kept in information memory.
  *
  ***************************************************************************/
 
 /* Define 7-seg to hex values, use not operator if display is common anode*/
-#define _A BIT6
-#define _B BIT4
-#define _C BIT1
-#define _D BIT0
-#define _E BIT3
-#define _F BIT5
-#define _G BIT2
-
 #define ZERO    _G
 #define ONE     _A + _D + _E + _F +_G
 #define TWO     _F + _C
@@ -36,10 +38,31 @@
 #define SEVEN   _D + _E + _F + _G
 #define EIGHT   0
 #define NINE    _E
-#define ECHO_P  (BIT1)
-#define TRIG_P  (BIT0)
+#define SEG_BLANK 0xFF
+#define LIT(segs) (SEG_PINS & ~(segs))      // pattern lighting the given segments
 
-#define BUF_SIZE 7
+/* Clock, MCLK from the fastest DCO calibration that divides to a 1MHz SMCLK.
+ * The DCO never changes, compute bursts run MCLK undivided and idle waits
+ * divide it back down to 1MHz, so SMCLK timing is the same in both. */
+#define MCLK_MHZ 8                  // MCLK during compute bursts
+#define IDLE_MHZ 1                  // MCLK while waiting
+#if MCLK_MHZ == 8
+#define CALBC1_MCLK CALBC1_8MHZ
+#define CALDCO_MCLK CALDCO_8MHZ
+#define SMCLK_DIV DIVS_3
+#define IDLE_DIV DIVM_3
+#elif MCLK_MHZ == 1
+#define CALBC1_MCLK CALBC1_1MHZ
+#define CALDCO_MCLK CALDCO_1MHZ
+#define SMCLK_DIV DIVS_0
+#define IDLE_DIV DIVM_0
+#else
+#error "MCLK_MHZ must divide down to a 1MHz SMCLK"
+#endif
+#define DELAY_US(us) __delay_cycles((unsigned long) (us) * MCLK_MHZ)
+#define IDLE_DELAY_US(us) __delay_cycles((unsigned long) (us) * IDLE_MHZ)
+#define CLOCK_FAST() BCSCTL2 = ClockFast
+#define CLOCK_SLOW() BCSCTL2 = ClockSlow
 
 #define X_MIN 405
 #define X_MID 505
@@ -53,6 +76,178 @@
 #define Z_MID 526
 #define Z_MAX 626
 
+#define G_COUNTS 97                 // default ADC counts per 1 g
+
+/* Accelerometer calibration kept in information memory */
+#define AXIS_X 0
+#define AXIS_Y 1
+#define AXIS_Z 2
+#define CAL_MAGIC 0xCA1B
+#define CAL_STEPS 6                 // +X, -X, +Y, -Y, +Z, -Z facing up
+#define CAL_MIN_GAIN 20             // reject captures with less spread than this
+#define CAL_SEG_B ((const struct Calibration *) INFO_SEG(INFO_B))
+#define CAL_SEG_C ((const struct Calibration *) INFO_SEG(INFO_C))
+#define CAL_WORDS (sizeof(struct Calibration) / sizeof(unsigned int))
+
+/* Watchdog heartbeats, fed only once every task of the role checked in */
+#define BEAT_BUTTONS BIT0           // sensor: button events handled
+#define BEAT_MEASURE BIT1           // sensor: distance or angle measured
+#define BEAT_OUTPUT BIT2            // sensor: frame handed to the UART
+#define BEAT_RX BIT3                // display: receive path armed or frame waiting
+#define BEAT_DISPLAY BIT4           // display: scan ISR finished a frame
+#define BEAT_SENSOR (BEAT_BUTTONS + BEAT_MEASURE + BEAT_OUTPUT)
+#define BEAT_DISPLAY_MCU (BEAT_RX + BEAT_DISPLAY)
+
+/* Button debouncer driven by Timer1_A CCR2 */
+#define BTN_MASK (BTN_PRESET + BTN_MODE)
+#define BTN_COUNT 2
+#define DEBOUNCE_TICKS 5000         // 5ms sample period at SMCLK 1MHz
+#define DEBOUNCE_MAX 4              // integrator saturates after 20ms of stable input
+#define LONG_TICKS 200              // 1s hold reports a long press
+#define REPEAT_TICKS 50             // then repeats every 250ms while held
+#define EVENT_QUEUE_SIZE 8          // power of two
+
+/* Command channel into the sensor MCU, 9600 8N1 received on P2.3 by Timer1_A CCR0
+ * from the display MCU's UART TX. Commands are '#' letter [decimal argument] ';'
+ * and each is answered on the UART as a text line the display never takes for a
+ * frame or a control character: '!', '+' or '-', the letter or CMD_UNKNOWN for
+ * one the sensor does not know, ';'.
+ *   #M0; #M1;     DISTANCE or ANGLE mode
+ *   #Pn;          select preset n, 0-4
+ *   #Tcm;         set the selected preset distance, 1-400cm
+ *   #Sms;         sample period, SAMPLE_MIN-SAMPLE_MAX ms
+ *   #D;           diagnostics text line before the answer, with the
+ *                 accelerometer axes in milli-g
+ * A command not finished within CMD_TIMEOUT loops is answered with '-'.
+ * Every command sets a value, so running it twice on a retry is harmless.
+ *
+ * The display MCU handles #B requests itself, see commandBright(). Any
+ * other '#' line received from the operator console on its RX is relayed
+ * to the sensor, which is given CMD_REPLY_FRAMES scan frames to answer.
+ * The request is sent again up to CMD_RETRIES times, then the outcome is
+ * shown for CMD_SHOW_FRAMES: "donE", "Err" when refused or "nonE" without
+ * an answer. */
+#define CMD_BIT_TICKS 104           // 9600 baud at SMCLK 1MHz
+#define CMD_QUEUE_SIZE 16           // power of two
+#define CMD_START '#'
+#define CMD_END ';'
+#define CMD_TIMEOUT 3               // main loops
+#define CMD_UNKNOWN '*'             // answered in place of a letter the sensor does not know
+#define CMD_LINE_SIZE 7             // '#', letter, 4 digits, ';'
+#define CMD_REPLY_FRAMES 160        // 1.28s, covers SAMPLE_MAX and one measurement
+#define CMD_RETRIES 2
+#define CMD_SHOW_FRAMES 125         // 1s
+#define PRESET_COUNT 5
+#define SAMPLE_STEP 10              // ms per idle wait, below the 65ms Timer1_A wrap
+#define SAMPLE_MIN 20
+#define SAMPLE_MAX 1000             // stays well inside the watchdog period
+
+/* Display multiplexer on the display MCU. Timer0_A CCR1 starts a SCAN_TICKS
+ * slot per place and lights its digit, CCR2 turns it off after OnTicks[] of
+ * the slot: the brightness level from BrightTicks[] scaled by the place's
+ * DigitDuty[]. The level follows the light sensor on AMBIENT_P, or is set
+ * over the UART with BRIGHT_CHAR or a #B request, which also sets the duty
+ * of a place with dutySet(). */
+#define SCAN_TICKS 250              // 2ms per place at SMCLK/8, 125Hz refresh
+#define SCAN_MIN_ON 6               // shortest on time, covers the ISR entry at 1MHz MCLK
+#define DUTY_SHIFT 4                // DigitDuty[] is in 1/16ths
+#define DUTY_FULL (1 << DUTY_SHIFT)
+#define BRIGHT_LEVELS 8
+#define BRIGHT_DEFAULT 7            // level without AUTO_DIM, 0-7
+#define BRIGHT_CHAR 'B'             // received on the display MCU, steps auto then each fixed level
+#define AUTO_DIM 1                  // follow the light sensor, set 0 on boards without one
+#define AMBIENT_FRAMES 32           // light sample every 32 scan frames, about 256ms
+#define AMBIENT_SHIFT 3             // light average over about 8 samples
+#define AMBIENT_BAND 7              // 1024 ADC counts / 128 = BRIGHT_LEVELS bands
+#define AMBIENT_HYST 16             // ADC counts past a band edge before the level moves
+
+/* Text renderer on the display MCU. display() builds the readout as a strip
+ * of segment patterns and textShow() hands it to the scan ISR, which shows
+ * DIGIT_COUNT places of it. A longer strip scrolls left one place every
+ * SCROLL_FRAMES scan frames, a shorter one is right aligned. */
+#define STRIP_SIZE 16
+#define SCROLL_FRAMES 40            // 320ms per place
+#define SCROLL_GAP 2                // blanks between the end and the restart of a scrolling strip
+#define NUMBER_WIDTH 7              // widest textNumber field, sign and 5 digits fit
+#define DEGREE '^'                  // drawn as a raised o
+
+#if (CMD_REPLY_FRAMES * DIGIT_COUNT * SCAN_TICKS) / 125 <= SAMPLE_MAX
+#error "CMD_REPLY_FRAMES must outlast the longest sample period"
+#endif
+
+#if (1024 >> AMBIENT_BAND) != BRIGHT_LEVELS
+#error "AMBIENT_BAND must split the ADC range into BRIGHT_LEVELS bands"
+#endif
+
+/* ISR profiling against the free-running Timer1_A, set to 1 to enable */
+#ifndef ISR_PROFILE
+#define ISR_PROFILE 0
+#endif
+#define PROF_BINS 12                // log2 histogram, last bin holds >= 2048 ticks
+#define PROF_DUMP_CHAR '?'          // received on the display MCU to request a dump
+
+/* Link statistics kept by the display MCU, set LINK_STATS to 1 to enable */
+#define LINK_STATS 0
+#define LINK_DUMP_CHAR 'L'          // received on the display MCU to dump and show the next statistic
+
+/* Binary event trace kept in RAM, set TRACE to 1 to enable */
+#define TRACE 0
+#define TRACE_RECORDS 16            // power of two, 6 bytes each
+#define TRACE_VERSION 2             // bump when the dump layout changes
+
+/* Raw input capture for off-target replay, set to 1 to stream capture
+ * records over the UART in place of display frames. Version 1 layout,
+ * all words little-endian:
+ *   header  'S' 'C' 'A' 'P' version record_length   (sent at reset)
+ *   record  0xA5 mode time travel adc_samples[0..7] xor
+ *           mode     'D' or 'A', selects which inputs the loop consumed
+ *           time     256us ticks of Timer1_A, wraps every 16.7s
+ *           travel   raw Travel_time in SMCLK ticks
+ *           xor      XOR of every record byte after the 0xA5 sync
+ */
+#define CAPTURE 0
+#define CAPTURE_VERSION 1
+#define CAPTURE_SYNC 0xA5
+#define CAPTURE_RECORD 23           // bytes per record including sync and xor
+
+/* Main loop load monitor against the free-running Timer1_A, set to 1 to enable */
+#ifndef LOOP_PROFILE
+#define LOOP_PROFILE 0
+#endif
+#define LOOP_WINDOW 1000000UL       // statistics window, 1s of SMCLK ticks
+#define LOOP_MAX_SHOWN 9999         // largest value that fits the display
+
+/* Timer1_A overflows counted by its ISR, for times past the 65ms wrap */
+#define TIMER_EPOCH (TRACE || CAPTURE || LOOP_PROFILE)
+
+#if LOOP_PROFILE
+#define LOOP_MARK(task) LoopMark = loopTask(task, LoopMark)
+#else
+#define LOOP_MARK(task)
+#endif
+
+#if TRACE
+#define TRACE_EVENT(id, arg, value) trace(id, arg, value)
+#else
+#define TRACE_EVENT(id, arg, value)
+#endif
+
+#if LINK_STATS
+#define LINK_COUNT(metric) LinkStats[metric]++
+#else
+#define LINK_COUNT(metric)
+#endif
+
+#if ISR_PROFILE
+#define PROF_ENTER() unsigned int profStart = TA1R
+#define PROF_EXIT(id) profRecord(&IsrProfiles[id], TA1R - profStart)
+#define PROF_LATENCY(id, event) profLatency(&IsrProfiles[id], profStart - (event))
+#else
+#define PROF_ENTER()
+#define PROF_EXIT(id)
+#define PROF_LATENCY(id, event)
+#endif
+
 /* Global variables */
 volatile unsigned int Start;
 volatile unsigned int End;
@@ -61,16 +256,36 @@ volatile unsigned int Distance = 0;
 volatile unsigned int Level = 0;
 volatile unsigned int Counting = 0;
 volatile unsigned int Edge = 0;
-static char TxBuffer[BUF_SIZE], RxBuffer[BUF_SIZE], Digits[BUF_SIZE];
-unsigned int TxBufIndex = 0, RxBufIndex = 0;
+unsigned char ClockFast = DIVS_0, ClockSlow = DIVS_0;  // BCSCTL2 for bursts and idle, set by startup
 unsigned int data0[10], data1[10], data2[10], data3[10], data4[10];
 volatile unsigned int myPresetDistances[5] = { 5, 25, 60, 100, 220 }; // Preset Default
 volatile unsigned int mySortedDistances[5] = { 5, 10, 15, 20, 25 }; // Sorted Default
 volatile unsigned int myPresetDistancesIndex = 0;
+unsigned int SamplePeriod = 100;                // ms between samples, set by the S command
+volatile unsigned char CmdQueue[CMD_QUEUE_SIZE];
+volatile unsigned int CmdHead = 0, CmdTail = 0;
+unsigned char CmdBits, CmdByte;                 // software UART receive state
+unsigned char CmdLetter = 0;                    // 0 idle, CMD_START waiting for the letter, else parsing
+unsigned char CmdDigits, CmdAge;
+unsigned int CmdArg;
 volatile unsigned int adc_samples[8];
 volatile int x, y, z;
 volatile unsigned int thetaX, thetaY;
 
+struct Calibration
+{
+    unsigned int magic;
+    unsigned int count;             // number of saves, newest valid copy wins
+    int offset[3];                  // zero g reading per axis
+    int gain[3];                    // counts per 1 g per axis
+    unsigned int checksum;
+};
+struct Calibration Cal = { CAL_MAGIC, 0, { X_MID, Y_MID, Z_MID }, { G_COUNTS, G_COUNTS, G_COUNTS }, 0 };
+const struct Calibration *CalSegment = CAL_SEG_C;   // segment holding the active copy
+int Accel[3];                                       // averaged raw reading per axis
+int CalCapture[CAL_STEPS][3];
+volatile unsigned int CalStep = 0;                  // positions captured so far
+
 enum System
 {
     DISTANCE, ANGLE
@@ -81,37 +296,222 @@ enum Bool
     FALSE, TRUE
 };
 volatile enum Bool Sort = FALSE;
+volatile enum Bool CalRequest = FALSE;
+char ReqLine[CMD_LINE_SIZE];                    // request collected from the console, display MCU
+volatile unsigned char ReqLen = 0;              // 0 idle, else bytes of ReqLine collected
+volatile enum Bool ReqReady = FALSE;
+char ReqSent[CMD_LINE_SIZE];                    // request waiting for its answer
+unsigned char ReqSentLen, ReqTries;
+unsigned int ReqWait = 0;                       // scan frames left for the answer, 0 none pending
+volatile unsigned char ReplyLen = 0;            // 0 idle, else bytes of the text line received, up to 2
+volatile char ReplyStatus = 0;                  // '+' or '-' of the last answer, 0 none
+unsigned int ReqShown = 0;                      // scan frames the outcome stays on the display
+const char *ReqResult;
 enum Flags
 {
     STOP, SET, SAVE
 };
 volatile enum Flags Flag = STOP;
+enum Events
+{
+    EV_NONE, EV_PRESS, EV_LONG, EV_REPEAT
+};
+
+struct Button
+{
+    unsigned char pin;              // port 2 bit
+    unsigned char integrator;       // 0 = released, DEBOUNCE_MAX = pressed
+    unsigned char held;             // 0 = released, 1 = press reported, 2 = long press reported
+    unsigned int ticks;             // ticks until next long press or repeat event
+};
+struct Button Buttons[BTN_COUNT] = { { BTN_PRESET, 0, 0, 0 }, { BTN_MODE, 0, 0, 0 } };
+volatile unsigned char EventQueue[EVENT_QUEUE_SIZE];  // (button << 2) | event
+volatile unsigned int EventHead = 0, EventTail = 0;
+
+#if LOOP_PROFILE
+enum Tasks
+{
+    TASK_BUTTONS, TASK_MEASURE, TASK_OUTPUT, TASK_IDLE, TASK_COUNT
+};
+enum LoopMetrics
+{
+    LOOP_BUSY,                      // busy time in percent
+    LOOP_RATE,                      // main loop rate in 0.1Hz
+    LOOP_BOOT,                      // 0.1ms from the top of main to the first frame, 6.5s at most
+    LOOP_WDT,                       // watchdog resets recorded in information memory
+    LOOP_TASK,                      // average us per loop of each task before TASK_IDLE
+    LOOP_METRICS = LOOP_TASK + TASK_IDLE
+};
+unsigned long LoopTicks[TASK_COUNT];            // ticks spent per task in this window
+unsigned int LoopCount = 0;                     // loops completed in this window
+unsigned int LoopMark;                          // end of the last timed task
+unsigned int LoopStats[LOOP_METRICS];           // results of the last full window
+volatile unsigned int LoopMetric = LOOP_BUSY;   // metric sent while in debug mode
+volatile enum Bool LoopDebug = FALSE;
+#endif
+
+#if TRACE
+enum TraceEvents
+{
+    TR_ECHO = 1,                    // value = raw Travel_time
+    TR_DISTANCE,                    // value = filtered Distance
+    TR_LEVEL,                       // arg = System, value = Level
+    TR_FRAME,                       // arg = mode flag, value = number sent
+    TR_BUTTON                       // arg = (button << 2) | event
+};
+struct TraceRecord
+{
+    unsigned int time;              // 256us ticks of Timer1_A, wraps every 16.7s
+    unsigned char id;
+    unsigned char arg;
+    unsigned int value;
+};
+struct TraceRecord TraceBuf[TRACE_RECORDS];
+unsigned int TraceHead = 0, TraceCount = 0;
+volatile enum Bool TraceDumpRequest = FALSE;
+#endif
+
+#if TIMER_EPOCH
+volatile unsigned int TimerEpoch = 0;           // Timer1_A overflows
+#endif
+
+#if CAPTURE
+unsigned int RawTravel;                         // Travel_time consumed by triggerSensor()
+unsigned int RawSamples[8];                     // adc_samples[] consumed in ANGLE mode
+#endif
+
+#if ISR_PROFILE
+enum Profiles
+{
+    PROF_TIMER1_A1, PROF_PORT2, PROF_USCI0RX, PROF_TIMER0_A1, PROF_COUNT
+};
+struct IsrProfile
+{
+    unsigned int count;             // completed ISR runs
+    unsigned int min;               // execution ticks, entry to exit
+    unsigned int max;
+    unsigned long total;
+    unsigned int hist[PROF_BINS];   // runs per log2 execution ticks
+    unsigned int latCount;          // runs with a known hardware event time
+    unsigned int latMax;            // ticks from hardware event to ISR entry
+    unsigned long latTotal;
+};
+struct IsrProfile IsrProfiles[PROF_COUNT];
+static const char *const ProfNames[PROF_COUNT] = { "TIMER1_A1", "PORT2", "USCI0RX", "TIMER0_A1" };
+volatile enum Bool ProfDumpRequest = FALSE;
+#endif
+
+#if LINK_STATS
+volatile unsigned int LinkShown = 0;            // 0 shows frames, else statistic LinkShown - 1
+volatile enum Bool LinkDumpRequest = FALSE;
+#endif
+
+static const unsigned char DigitSelect[DIGIT_COUNT] = { DIGIT_1, DIGIT_2, DIGIT_3, DIGIT_4 };
+static const unsigned char BrightTicks[BRIGHT_LEVELS] = { 8, 12, 20, 32, 50, 80, 140, 234 };   // about even perceived steps
+unsigned char DigitDuty[DIGIT_COUNT] = { DUTY_FULL, DUTY_FULL, DUTY_FULL, DUTY_FULL };
+static unsigned char Strips[2][STRIP_SIZE];    // handed between display() and the scan ISR by pointer
+static unsigned char *TextStrip = Strips[0];    // built by the main loop
+static unsigned char *ShownStrip = Strips[1];   // read by the scan ISR
+unsigned int TextLen = 0;
+volatile unsigned int ShownLen = DIGIT_COUNT;
+volatile unsigned int ScrollPos = 0;            // strip place shown leftmost
+unsigned int ScrollTick = 0;                    // scan frames since the last scroll step
+volatile unsigned int OnTicks[DIGIT_COUNT];     // lit ticks per place, set by brightnessSet
+volatile unsigned int ScanFrames = 0;           // completed passes over all places
+volatile unsigned int BrightManual = 0;         // 0 follows the light sensor, else level BrightManual - 1
+unsigned int Brightness = BRIGHT_LEVELS;        // out of range until brightnessSet runs
+#if AUTO_DIM
+unsigned int AmbientSum = 1023 << AMBIENT_SHIFT;    // start bright and settle down
+unsigned int AmbientFrame = 0;                  // ScanFrames at the last light sample
+#endif
 
 /* Function Prototypes */
-int hwFlag(void);
+int startup(void);
 void portInit0(void);
 void portInit1(void);
 void setSpeaker(void);
-void setDistance(int);
+void setDistance(unsigned int);
 void convertSensor(int);
-void transmit(void);
-void receive(void);
 void display(void);
-void displayDigit(char);
+unsigned char segmentCode(char);
+void textClear(void);
+void textPutc(char);
+void textPuts(const char*);
+void textNumber(int, unsigned int, unsigned int);
+void textShow(void);
+void brightnessSet(unsigned int);
+void dutySet(unsigned int, unsigned int);
+void brightnessPoll(void);
+#if AUTO_DIM
+unsigned int ambientLevel(void);
+#endif
 void triggerSensor(void);
 int avg(unsigned int*, unsigned int);
+unsigned int calChecksum(const struct Calibration*);
+void calLoad(void);
+void calSave(void);
+void calCapture(void);
+void postEvent(unsigned char);
+unsigned char getEvent(void);
+unsigned int debounce(void);
+void handleButtons(void);
+void commandPoll(void);
+void commandRun(unsigned char, unsigned int, unsigned char);
+void commandDiag(void);
+void commandAck(unsigned char, enum Bool);
+void commandRequest(void);
+void commandSend(void);
+enum Bool commandBright(unsigned int, unsigned char);
+#if LOOP_PROFILE
+unsigned int loopTask(unsigned int, unsigned int);
+void loopWindow(void);
+#endif
+#if TIMER_EPOCH
+unsigned int timeStamp(void);
+#endif
+#if CAPTURE
+void captureHeader(void);
+void captureSend(void);
+#endif
+#if TRACE
+void trace(unsigned char, unsigned char, unsigned int);
+void traceDump(void);
+#endif
+#if ISR_PROFILE
+void profRecord(struct IsrProfile*, unsigned int);
+void profLatency(struct IsrProfile*, unsigned int);
+void profDump(void);
+#endif
 
 int main(void)
 {
-    int mcu = hwFlag();
+    unsigned int wait;
+#if CAPTURE
+    unsigned int i;
+#endif
+    int mcu = startup();
     if (mcu == 0)
     { // Activate Measuring code on MCU0
         portInit0();
+        calLoad();                                  // restore accelerometer calibration
+#if CAPTURE
+        captureHeader();
+#endif
+#if LOOP_PROFILE
+        LoopStats[LOOP_WDT] = WdtResets;
+        LoopMark = TA1R;
+#endif
         while (1)
         {
+            CLOCK_FAST();                           // measure, encode and send at full speed
+            handleButtons();                        // act on debounced button events
+            commandPoll();                          // and on commands from the UART
+            HEARTBEAT(BEAT_BUTTONS);
+            LOOP_MARK(TASK_BUTTONS);
+
             if (System == DISTANCE)
             {
-                Digits[5] = 'D';                            // System Mode Flag
+                Digits[FRAME_MODE] = MODE_DISTANCE;                          // System Mode Flag
                 triggerSensor();                            // Capture ultrasonic measurements
                 convertSensor(Distance);                    // Convert sensor value into char
 
@@ -127,35 +527,61 @@ int main(void)
             }
             else
             {
-                Digits[5] = 'A';                            // System Mode Flag
+                Digits[FRAME_MODE] = MODE_ANGLE;                          // System Mode Flag
                 ADC10CTL0 &= ~ENC;
                 while ((ADC10CTL1 & ADC10BUSY));            // wait until sample operation is complete
                 ADC10CTL0 |= ENC + ADC10SC;                 // enable and start conversion
                 ADC10SA = (unsigned int) adc_samples;       // send values to sample array
+#if CAPTURE
+                for (i = 0; i < 8; i++)
+                {
+                    RawSamples[i] = adc_samples[i];
+                }
+#endif
+
+                Accel[AXIS_X] = avg(data0, adc_samples[2]);
+                Accel[AXIS_Y] = avg(data1, adc_samples[6]);
+                Accel[AXIS_Z] = avg(data2, adc_samples[4]);
 
-                x = abs(avg(data0, adc_samples[2]) - X_MID);    // take absolute value of X axis
-                y = abs(avg(data1, adc_samples[6]) - Y_MID);    // take absolute value of Y axis
-                z = abs(avg(data2, adc_samples[4]) - Z_MID);
+                x = abs(Accel[AXIS_X] - Cal.offset[AXIS_X]);    // take absolute value of X axis
+                y = abs(Accel[AXIS_Y] - Cal.offset[AXIS_Y]);    // take absolute value of Y axis
+                z = abs(Accel[AXIS_Z] - Cal.offset[AXIS_Z]);
 
-                if (x < 98)
+                if (x <= Cal.gain[AXIS_X])
                 {
-                    thetaX = asinf(((float) (x) / 97)) * 180 * M_1_PI;
+                    thetaX = asinf(((float) (x) / Cal.gain[AXIS_X])) * 180 * M_1_PI;
                 }
                 else
                 {
                     thetaX = 90;
                 }
 
-                if (y < 98)
+                if (y <= Cal.gain[AXIS_Y])
                 {
-                    thetaY = asinf(((float) (y) / 97)) * 180 * M_1_PI;
+                    thetaY = asinf(((float) (y) / Cal.gain[AXIS_Y])) * 180 * M_1_PI;
                 }
                 else
                 {
                     thetaY = 90;
                 }
 
-                convertSensor((thetaX * 100) + thetaY);
+                if (CalRequest)
+                {
+                    calCapture();                   // store position, save after the last one
+                    CalRequest = FALSE;
+                }
+
+                if (CalStep > 0)
+                {
+                    Digits[FRAME_MODE] = MODE_CAL;
+                    convertSensor(CalStep);         // show number of captured positions
+                }
+                else
+                {
+                    convertSensor((thetaX * 100) + thetaY);
+                    Digits[FRAME_SIGNS] = SIGN_BASE + ((Accel[AXIS_X] < Cal.offset[AXIS_X]) ? SIGN_X : 0)
+                            + ((Accel[AXIS_Y] < Cal.offset[AXIS_Y]) ? SIGN_Y : 0);
+                }
 
                 if ((thetaX * 100 + thetaY) == 0)
                 {
@@ -167,27 +593,118 @@ int main(void)
                 }
 
             }
+            HEARTBEAT(BEAT_MEASURE);
 
+            LOOP_MARK(TASK_MEASURE);
+
+            TRACE_EVENT(TR_LEVEL, System, Level);
             setSpeaker();                   // Sets speaker output
-            transmit();                     // Send converted char's through UART
-            __delay_cycles(100000);         // Sample every 200ms or 5Hz frequency
+#if LOOP_PROFILE
+            if (LoopDebug)
+            {
+                Digits[FRAME_MODE] = MODE_PROFILE;  // send the selected load metric instead
+                convertSensor(LoopStats[LoopMetric]);
+            }
+#endif
+#if CAPTURE
+            captureSend();                  // Stream raw inputs in place of the frame
+#else
+            linkSend();                     // Send converted char's through UART
+#endif
+            HEARTBEAT(BEAT_OUTPUT);
+#if LOOP_PROFILE
+            if (LoopStats[LOOP_BOOT] == 0)
+            {
+                unsigned long boot = ((unsigned long) timeStamp() * 256) / 100;   // overflows counted since startup()
+
+                LoopStats[LOOP_BOOT] = (boot > 0xFFFF) ? 0xFFFF : boot;
+            }
+#endif
+#if TRACE
+            if (TraceDumpRequest)
+            {
+                traceDump();                // long press of the preset button
+                TraceDumpRequest = FALSE;
+            }
+#endif
+#if ISR_PROFILE
+            if (ProfDumpRequest)
+            {
+                profDump();                 // long press of the mode button
+                ProfDumpRequest = FALSE;
+            }
+#endif
+            LOOP_MARK(TASK_OUTPUT);
+            supervise(BEAT_SENSOR);         // feed the watchdog if every task ran
+            CLOCK_SLOW();                   // nothing to compute until the next sample
+            for (wait = 0; wait < SamplePeriod; wait += SAMPLE_STEP)
+            {
+                IDLE_DELAY_US(SAMPLE_STEP * 1000UL);
+                LOOP_MARK(TASK_IDLE);       // timed in steps below the 65ms Timer1_A wrap
+            }
+#if LOOP_PROFILE
+            loopWindow();
+#endif
         }
     }
-    if (mcu == 1)
+    else
     {                                       // Activate Display code on MCU1
+        unsigned int frames = 0;
+
         portInit1();
+        textShow();                         // blank until the first frame
         while (1)
         {
             if (Flag == SAVE)
             {
-                receive();
-                IE2 |= UCA0RXIE;            // Enable USCI_A0 RX interrupt
+                linkReceive();              // show the frame, RX interrupt enabled again
+#if LINK_STATS
+                linkFrame(Digits[FRAME_SEQ], linkTime());
+#endif
                 Flag = STOP;
+#if LINK_STATS
+                if (LinkShown == 0)
+#endif
+                display();                  // render the new frame for the scan ISR
+            }
+#if ISR_PROFILE
+            else if (ProfDumpRequest)
+            {
+                profDump();
+                ProfDumpRequest = FALSE;
+            }
+#endif
+#if LINK_STATS
+            else if (LinkDumpRequest)
+            {
+                linkDump();
+                LinkDumpRequest = FALSE;
             }
+#endif
             else
             {
-                display();                  // Display the distance value
+#if LINK_STATS
+                if (LinkShown)
+                {
+                    textClear();
+                    textNumber((LinkStats[LinkShown - 1] > LOOP_MAX_SHOWN) ? LOOP_MAX_SHOWN : LinkStats[LinkShown - 1], DIGIT_COUNT, 0);
+                    textShow();
+                }
+#endif
+                brightnessPoll();
+            }
+            commandRequest();               // console requests relayed to the sensor
+            if (ScanFrames != frames)
+            {
+                frames = ScanFrames;
+                HEARTBEAT(BEAT_DISPLAY);    // scan ISR still running
             }
+            if ((IE2 & UCA0RXIE) || (Flag == SAVE))
+            {
+                HEARTBEAT(BEAT_RX);         // not stuck with RX disabled and nothing to save
+            }
+            supervise(BEAT_DISPLAY_MCU);
+            __bis_SR_register(LPM0_bits + GIE);     // the scan ISR wakes us once per frame
         }
     }
 }
@@ -218,350 +735,1545 @@ int avg(unsigned int *arr, unsigned int val)
 }
 
 /*
- * Function: hwFlag
+ * Function: calChecksum
  * ---------------------
- * Reads pin 1.0 to determine which code function should be read on the microcontroller.
- * Acts as a hardware flag.
+ * Returns the checksum of every calibration word ahead of the checksum
+ * field.
  */
-int hwFlag(void)
+unsigned int calChecksum(const struct Calibration *cal)
 {
-    WDTCTL = WDTPW | WDTHOLD;
-    P1DIR &= ~BIT0;
-    P1REN = BIT0;
-    P1OUT = 0;
-    return P1IN & BIT0;
+    return flashChecksum(cal, CAL_WORDS - 1);
 }
 
 /*
- * Function: triggerSensor
+ * Function: calLoad
  * ---------------------
- * Toggles the trigger pin to be on for 10us. Calculates the distance value
- * and averages the measurements to increase accurately.
+ * Loads the newest valid calibration copy from information memory
+ * segments B and C. The compiled in defaults stay active when
+ * neither copy passes the magic and checksum test.
  */
-void triggerSensor(void)
+void calLoad(void)
 {
-    TA1CTL |= TACLR;
-    P2OUT |= TRIG_P;
-    __delay_cycles(10); // 10 us
-    P2OUT &= ~TRIG_P;
-
-    unsigned int val = 0;
-
-    val = avg(data1, Travel_time / 58);
+    const struct Calibration *seg[2] = { CAL_SEG_B, CAL_SEG_C };
+    const struct Calibration *best = 0;
+    unsigned int i;
 
-    if (val > 400)
+    for (i = 0; i < 2; i++)
     {
-        Distance = 400;         // Maximum range of 400m
+        if ((seg[i]->magic == CAL_MAGIC) && (seg[i]->checksum == calChecksum(seg[i])))
+        {
+            if ((best == 0) || ((int) (seg[i]->count - best->count) > 0))
+            {
+                best = seg[i];
+            }
+        }
     }
-    else
+
+    if (best != 0)
     {
-        Distance = val;
+        Cal = *best;
+        CalSegment = best;
     }
 }
 
 /*
- * Function: convertSensor
+ * Function: calSave
  * ---------------------
- * Receives the sampled ultrasonic sensor value and splits it
- * into digit places using modulo division.
- * Based off position place a key is created.
- * Values stored into global array.
+ * Writes the calibration into the segment not holding the active copy,
+ * so both segments wear evenly and the old copy survives a power loss
+ * part way through the erase or write.
  */
-void convertSensor(int readVal)
+void calSave(void)
 {
-    unsigned int key = 0;
-    if (readVal > 999)
-    {                 // Capture 1000s place
-        key = 4;
-    }
-    else if (readVal > 99)
-    {                 // Capture 100s place
-        key = 3;
-    }
-    else if (readVal > 9)
-    {              // Capture 10s place
-        key = 2;
-    }
-    else
-    {
-        key = 1;
-    }
-    Digits[0] = (readVal % 10) + 48;
-    readVal /= 10;
-    Digits[1] = (readVal % 10) + 48;
-    readVal /= 10;
-    Digits[2] = (readVal % 10) + 48;
-    readVal /= 10;
-    Digits[3] = (readVal % 10) + 48;
+    unsigned int *dst;
 
-    if (System == DISTANCE)
-    {
-        Digits[4] = key + 48;
-    }
-    else
-    {
-        Digits[4] = 4 + 48;
-    }
-    Digits[6] = ','; // add , as stop flag
+    dst = (unsigned int *) ((CalSegment == CAL_SEG_B) ? CAL_SEG_C : CAL_SEG_B);
+    Cal.magic = CAL_MAGIC;
+    Cal.count++;
+    Cal.checksum = calChecksum(&Cal);
+    flashWrite(dst, &Cal, CAL_WORDS);
+
+    CalSegment = (const struct Calibration *) dst;
 }
 
 /*
- * Function: setDistance
+ * Function: calCapture
  * ---------------------
- * Sets the distance level for the speaker based off of selected threshold values
+ * Stores the averaged reading of all three axes for the next of the six
+ * calibration positions (+X, -X, +Y, -Y, +Z, -Z facing up). After the last
+ * position the offset and gain of each axis are taken from its up and down
+ * readings and saved to flash.
  */
-void setDistance(int readVal)
+void calCapture(void)
 {
-    if (readVal == myPresetDistances[0])
-    {
-        Level = 5;
-    }
-    else if (readVal == myPresetDistances[1])
+    int offset[3], gain[3];
+    unsigned int i;
+
+    for (i = 0; i < 3; i++)
     {
-        Level = 4;
+        CalCapture[CalStep][i] = Accel[i];
     }
-    else if (readVal == myPresetDistances[2])
+    CalStep++;
+
+    if (CalStep < CAL_STEPS)
     {
-        Level = 3;
+        return;
     }
-    else if (readVal == myPresetDistances[3])
+    CalStep = 0;
+
+    for (i = 0; i < 3; i++)
     {
-        Level = 2;
+        int up = CalCapture[2 * i][i];
+        int down = CalCapture[2 * i + 1][i];
+
+        offset[i] = (up + down) / 2;
+        gain[i] = abs(up - down) / 2;
+        if (gain[i] < CAL_MIN_GAIN)
+        {
+            return;                         // bad capture, keep the active calibration
+        }
     }
-    else if (readVal == myPresetDistances[4])
+
+    for (i = 0; i < 3; i++)
     {
-        Level = 1;
+        Cal.offset[i] = offset[i];
+        Cal.gain[i] = gain[i];
     }
-    else
+    calSave();
+}
+
+/*
+ * Function: postEvent
+ * ---------------------
+ * Adds a button event to the queue, dropping it when the queue is full.
+ */
+void postEvent(unsigned char event)
+{
+    unsigned int next = (EventHead + 1) & (EVENT_QUEUE_SIZE - 1);
+
+    if (next != EventTail)
     {
-        Level = 0;
+        EventQueue[EventHead] = event;
+        EventHead = next;
     }
 }
 
 /*
- * Function: setSpeaker
+ * Function: getEvent
  * ---------------------
- * Sets the interrupt timer values for the PWM to play certain notes based off of the distance level
+ * Removes the oldest button event from the queue.
+ *
+ * returns: (button << 2) | event, EV_NONE when the queue is empty
  */
-void setSpeaker()
+unsigned char getEvent(void)
 {
-    P2SEL &= ~BIT2;
-    switch (Level)
+    unsigned char event;
+
+    if (EventTail == EventHead)
     {
-    case 1:
-        TA0CCR0 = 12134; // E2
-        TA0CCR1 = 6067;
-        P2SEL |= BIT2;
-        break;
-    case 2:
-        TA0CCR0 = 3405; // D3
-        TA0CCR1 = 1702;
-        P2SEL |= BIT2;
-        break;
-    case 3:
-        TA0CCR0 = 2272; // A4
-        TA0CCR1 = 1136;
-        P2SEL |= BIT2;
-        break;
-    case 4:
-        TA0CCR0 = 1516; // E5
-        TA0CCR1 = 758;
-        P2SEL |= BIT2;
-        break;
-    case 5:
-        TA0CCR0 = 1136; // A6
-        TA0CCR1 = 568;
-        P2SEL |= BIT2;
-        break;
-    default:
-        TA0CCR0 = 0;
-        TA0CCR1 = 0;
-        P2SEL |= BIT2;
+        return EV_NONE;
     }
+    event = EventQueue[EventTail];
+    EventTail = (EventTail + 1) & (EVENT_QUEUE_SIZE - 1);
+    return event;
 }
 
 /*
- * Function: transmit
- * ----------------------
- * Transfers converted ADC data to Tx buffer and begins transmission
+ * Function: debounce
+ * ---------------------
+ * Runs once per debounce tick. Integrates the level of each button and
+ * posts press, long press and repeat events on stable transitions.
+ *
+ * returns: number of buttons still pressed or settling
  */
-void transmit()
+unsigned int debounce(void)
 {
+    unsigned int active = 0;
     unsigned int i;
-    for (i = 0; i < sizeof(TxBuffer); i++)
+
+    for (i = 0; i < BTN_COUNT; i++)
     {
-        TxBuffer[i] = Digits[i];
+        struct Button *btn = &Buttons[i];
+
+        if ((P2IN & btn->pin) == 0)
+        {                                   // pressed, pull-up reads low
+            if (btn->integrator < DEBOUNCE_MAX)
+            {
+                btn->integrator++;
+            }
+        }
+        else if (btn->integrator > 0)
+        {
+            btn->integrator--;
+        }
+
+        if (btn->held)
+        {
+            if (btn->integrator == 0)
+            {
+                btn->held = 0;              // release
+            }
+            else if (--btn->ticks == 0)
+            {
+                postEvent((i << 2) | ((btn->held == 1) ? EV_LONG : EV_REPEAT));
+                btn->held = 2;
+                btn->ticks = REPEAT_TICKS;
+            }
+        }
+        else if (btn->integrator == DEBOUNCE_MAX)
+        {
+            btn->held = 1;
+            btn->ticks = LONG_TICKS;
+            postEvent((i << 2) | EV_PRESS);
+        }
+
+        if (btn->integrator > 0)
+        {
+            active++;
+        }
     }
-    TxBufIndex = 0;
-    IE2 |= UCA0TXIE;                        // Enable USCI_A0 TX interrupt to begin UART transmission
+    return active;
 }
 
-// UART TX ISR to transmit data
-#pragma vector = USCIAB0TX_VECTOR
-__interrupt void USCI0TX_ISR(void)
+/*
+ * Function: handleButtons
+ * ---------------------
+ * Applies every queued button event to the sensor state.
+ */
+void handleButtons(void)
 {
-    UCA0TXBUF = TxBuffer[TxBufIndex];
-    TxBufIndex++;                           // Transmit next character
-    if (TxBufIndex >= sizeof(TxBuffer))
-    {                                       // Check if TX has been completed
-        TxBufIndex = 0;
-        IE2 &= ~UCA0TXIE;                   // Disable USCI_A0 TX interrupt
+    unsigned char event;
+
+    while ((event = getEvent()) != EV_NONE)
+    {
+        struct Button *btn = &Buttons[event >> 2];
+
+        TRACE_EVENT(TR_BUTTON, event, 0);
+        switch (event & 0x03)
+        {
+        case EV_PRESS:
+        case EV_REPEAT:
+#if LOOP_PROFILE
+            if (LoopDebug && (btn->pin == BTN_PRESET))
+            {
+                if ((event & 0x03) == EV_PRESS)
+                {
+                    LoopMetric = (LoopMetric + 1) % LOOP_METRICS;   // next load metric
+                }
+                break;
+            }
+#endif
+            if (btn->pin == BTN_MODE)
+            {
+                if ((event & 0x03) == EV_PRESS)
+                {
+                    System = (System == DISTANCE) ? ANGLE : DISTANCE;
+                    CalStep = 0;            // leaving a mode abandons calibration
+                }
+            }
+            else if (System == ANGLE)
+            {
+                if ((event & 0x03) == EV_PRESS)
+                {
+                    CalRequest = TRUE;      // capture next calibration position
+                }
+            }
+            else if (myPresetDistancesIndex == 4)
+            {
+                myPresetDistancesIndex = 0; // holding the preset button keeps cycling
+            }
+            else
+            {
+                myPresetDistancesIndex++;
+            }
+            break;
+        case EV_LONG:
+            if ((btn->pin == BTN_PRESET) && (System == ANGLE))
+            {
+                CalStep = 0;                // long press restarts calibration
+                CalRequest = FALSE;
+            }
+#if TRACE
+            if ((btn->pin == BTN_PRESET) && (System == DISTANCE))
+            {
+                TraceDumpRequest = TRUE;    // dump the trace after the next frame
+            }
+#endif
+#if ISR_PROFILE
+            if (btn->pin == BTN_MODE)
+            {
+                ProfDumpRequest = TRUE;     // dump ISR timing after the next frame
+            }
+#endif
+#if LOOP_PROFILE
+            if (btn->pin == BTN_MODE)
+            {
+                LoopDebug = (LoopDebug == TRUE) ? FALSE : TRUE; // show load metrics
+            }
+#endif
+            break;
+        default:
+            break;
+        }
     }
 }
 
-// UART RX ISR to receive data
-#pragma vector = USCIAB0RX_VECTOR
-__interrupt void USCI0RX_ISR(void)
+/*
+ * Function: commandPoll
+ * ---------------------
+ * Parses the bytes queued by the command receiver and runs every
+ * complete command. Bytes outside a command are ignored and a command
+ * left unfinished for CMD_TIMEOUT calls is rejected.
+ */
+void commandPoll(void)
 {
-    if (RxBufIndex < sizeof(Digits))
+    unsigned char c;
+
+    while (CmdTail != CmdHead)
     {
-        if (UCA0RXBUF == ',')
+        c = CmdQueue[CmdTail];
+        CmdTail = (CmdTail + 1) & (CMD_QUEUE_SIZE - 1);
+
+        if (c == CMD_START)
+        {
+            CmdLetter = CMD_START;
+            CmdArg = 0;
+            CmdDigits = 0;
+            CmdAge = 0;
+        }
+        else if (CmdLetter == 0)
+        {
+            // noise between commands
+        }
+        else if (CmdLetter == CMD_START)
+        {
+            CmdLetter = c;
+        }
+        else if (c == CMD_END)
+        {
+            commandRun(CmdLetter, CmdArg, CmdDigits);
+            CmdLetter = 0;
+        }
+        else if ((c >= '0') && (c <= '9') && (CmdDigits < 4))
         {
-            RxBufIndex = 0;
-            Flag = SAVE;
-            IE2 &= ~UCA0RXIE; // Disable USCI_A0 RX interrupt
+            CmdArg = (CmdArg * 10) + (c - '0');
+            CmdDigits++;
         }
         else
         {
-            RxBuffer[RxBufIndex] = UCA0RXBUF;
-            RxBufIndex++;
+            commandAck(CmdLetter, FALSE);
+            CmdLetter = 0;
         }
     }
-    else
+
+    if ((CmdLetter != 0) && (++CmdAge > CMD_TIMEOUT))
     {
-        RxBufIndex = 0;
+        commandAck(CmdLetter, FALSE);       // timed out part way through
+        CmdLetter = 0;
     }
 }
 
 /*
- * Function: receive
- * ----------------------
- * Stores received UART data from buffer into an array
+ * Function: commandRun
+ * ---------------------
+ * Applies one command when its argument is in range and answers it.
  */
-void receive()
+void commandRun(unsigned char letter, unsigned int arg, unsigned char digits)
 {
-    unsigned int i;
-    for (i = 0; i < sizeof(Digits); i++)
+    enum Bool ok = FALSE;
+
+    switch (letter)
     {
-        Digits[i] = RxBuffer[i];
+    case 'M':
+        if ((digits == 1) && (arg <= 1))
+        {
+            System = arg ? ANGLE : DISTANCE;
+            CalStep = 0;
+            ok = TRUE;
+        }
+        break;
+    case 'P':
+        if ((digits > 0) && (arg < PRESET_COUNT))
+        {
+            myPresetDistancesIndex = arg;
+            ok = TRUE;
+        }
+        break;
+    case 'T':
+        if ((digits > 0) && (arg >= 1) && (arg <= 400))
+        {
+            myPresetDistances[myPresetDistancesIndex] = arg;
+            ok = TRUE;
+        }
+        break;
+    case 'S':
+        if ((digits > 0) && (arg >= SAMPLE_MIN) && (arg <= SAMPLE_MAX))
+        {
+            SamplePeriod = arg;
+            ok = TRUE;
+        }
+        break;
+    case 'D':
+        if (digits == 0)
+        {
+            commandDiag();
+            ok = TRUE;
+        }
+        break;
+    }
+    commandAck(letter, ok);
+}
+
+/*
+ * Function: commandDiag
+ * ---------------------
+ * Writes the sensor settings, the last accelerometer reading of each
+ * axis in milli-g and the watchdog reset count as one text line.
+ */
+void commandDiag(void)
+{
+    static const char *const GravityLabel[3] = { " gx=", " gy=", " gz=" };
+    unsigned int i;
+    int milli;
+
+    while (IE2 & UCA0TXIE);                 // let the TX ISR finish its frame
+
+    uartPutc(FRAME_TEXT_START);
+    uartPuts("mode=");
+    uartPutNum(System);
+    uartPuts(" preset=");
+    uartPutNum(myPresetDistancesIndex);
+    uartPutc(':');
+    uartPutNum(myPresetDistances[myPresetDistancesIndex]);
+    uartPuts(" dist=");
+    uartPutNum(Distance);
+    uartPuts(" period=");
+    uartPutNum(SamplePeriod);
+    for (i = AXIS_X; i <= AXIS_Z; i++)
+    {
+        milli = gravityMilli(Accel[i] - Cal.offset[i], gravityScale(Cal.gain[i]));
+        uartPuts(GravityLabel[i]);
+        if (milli < 0)
+        {
+            uartPutc('-');
+            milli = -milli;
+        }
+        uartPutNum(milli);
+    }
+    uartPuts(" wdt=");
+    uartPutNum(WdtResets);
+    uartPutc(FRAME_TEXT_END);
+}
+
+/*
+ * Function: commandAck
+ * ---------------------
+ * Answers a command with a text line of '+' or '-' and its letter. Any
+ * letter the sensor does not know is answered as CMD_UNKNOWN, so
+ * whatever was sent never comes back raw.
+ */
+void commandAck(unsigned char letter, enum Bool ok)
+{
+    switch (letter)
+    {
+    case 'M':
+    case 'P':
+    case 'T':
+    case 'S':
+    case 'D':
+        break;
+    default:
+        letter = CMD_UNKNOWN;
+        break;
+    }
+
+    while (IE2 & UCA0TXIE);                 // let the TX ISR finish its frame
+
+    uartPutc(FRAME_TEXT_START);
+    uartPutc(ok ? '+' : '-');
+    uartPutc(letter);
+    uartPutc(FRAME_TEXT_END);
+}
+
+/*
+ * Function: commandRequest
+ * ---------------------
+ * Display MCU, once per scan frame. Sends a request collected by the RX
+ * ISR to the sensor and waits for its answer, sending it again after
+ * CMD_REPLY_FRAMES up to CMD_RETRIES times. The outcome is shown for
+ * CMD_SHOW_FRAMES, then display() brings the readout back.
+ */
+void commandRequest(void)
+{
+    unsigned char i;
+
+    if (ReqShown > 0)
+    {
+        if (--ReqShown == 0)
+        {
+            display();
+        }
+    }
+
+    if (ReqWait == 0)
+    {
+        if ((ReqReady == TRUE) && (ReqLine[1] == BRIGHT_CHAR))
+        {                                   // the display's own setting, not relayed
+            unsigned int arg = 0;
+            unsigned char digits = 0;
+
+            for (i = 2; i < ReqLen - 1; i++)
+            {
+                if ((ReqLine[i] < '0') || (ReqLine[i] > '9'))
+                {
+                    digits = 0xFF;          // not a number
+                    break;
+                }
+                arg = (arg * 10) + (ReqLine[i] - '0');
+                digits++;
+            }
+            ReqLen = 0;
+            ReqReady = FALSE;
+            ReqResult = (commandBright(arg, digits) == TRUE) ? "donE" : "Err";
+            ReqShown = CMD_SHOW_FRAMES;
+            display();
+        }
+        else if (ReqReady == TRUE)
+        {
+            for (i = 0; i < ReqLen; i++)
+            {
+                ReqSent[i] = ReqLine[i];
+            }
+            ReqSentLen = ReqLen;
+            ReqLen = 0;
+            ReqReady = FALSE;               // the RX ISR may collect the next one
+            ReqTries = 0;
+            commandSend();
+        }
+        return;
+    }
+
+    if (ReplyStatus != 0)
+    {
+        ReqResult = (ReplyStatus == '+') ? "donE" : "Err";
+    }
+    else if (--ReqWait > 0)
+    {
+        return;
+    }
+    else if (ReqTries < CMD_RETRIES)
+    {
+        ReqTries++;
+        commandSend();
+        return;
+    }
+    else
+    {
+        ReqResult = "nonE";
+    }
+    ReqWait = 0;
+    ReqShown = CMD_SHOW_FRAMES;
+    display();
+}
+
+/*
+ * Function: commandBright
+ * ---------------------
+ * Display MCU brightness request:
+ *   #Bn;          0 follows the light sensor, 1-8 holds level n - 1
+ *   #Bpdd;        duty of place p, 1 the rightmost to 4, dd 1-16 sixteenths
+ *
+ * returns: TRUE when applied, FALSE for an argument out of range
+ */
+enum Bool commandBright(unsigned int arg, unsigned char digits)
+{
+    if ((digits == 1) && (arg <= BRIGHT_LEVELS))
+    {
+        BrightManual = arg;                 // brightnessPoll() applies it
+        return TRUE;
+    }
+    if ((digits == 3) && (arg / 100 >= 1) && (arg / 100 <= DIGIT_COUNT) && (arg % 100 >= 1) && (arg % 100 <= DUTY_FULL))
+    {
+        dutySet((arg / 100) - 1, arg % 100);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Function: commandSend
+ * ---------------------
+ * Writes the pending request to the sensor and starts waiting for the
+ * answer.
+ */
+void commandSend(void)
+{
+    unsigned char i;
+
+    ReplyStatus = 0;
+    for (i = 0; i < ReqSentLen; i++)
+    {
+        uartPutc(ReqSent[i]);
+    }
+    ReqWait = CMD_REPLY_FRAMES;
+}
+
+#if LOOP_PROFILE
+/*
+ * Function: loopTask
+ * ---------------------
+ * Charges the ticks since the end of the previous task to the given task.
+ *
+ * returns: current timer value, the start of the next task
+ */
+unsigned int loopTask(unsigned int task, unsigned int start)
+{
+    unsigned int now = TA1R;
+
+    LoopTicks[task] += now - start;
+    return now;
+}
+
+/*
+ * Function: loopWindow
+ * ---------------------
+ * Counts a completed main loop. Once a full window has been timed the
+ * busy percentage, loop rate and average time of each task per loop
+ * are stored in LoopStats and the window restarts.
+ */
+void loopWindow(void)
+{
+    unsigned long total = 0;
+    unsigned long val;
+    unsigned int i;
+
+    LoopCount++;
+    for (i = 0; i < TASK_COUNT; i++)
+    {
+        total += LoopTicks[i];
+    }
+    if (total < LOOP_WINDOW)
+    {
+        return;
+    }
+
+    LoopStats[LOOP_BUSY] = ((total - LoopTicks[TASK_IDLE]) * 100) / total;
+    LoopStats[LOOP_RATE] = (LoopCount * 10000000UL) / total;
+    for (i = 0; i < TASK_IDLE; i++)
+    {
+        val = LoopTicks[i] / LoopCount;
+        LoopStats[LOOP_TASK + i] = (val > LOOP_MAX_SHOWN) ? LOOP_MAX_SHOWN : val;
+    }
+
+    for (i = 0; i < TASK_COUNT; i++)
+    {
+        LoopTicks[i] = 0;
+    }
+    LoopCount = 0;
+}
+#endif
+
+#if TIMER_EPOCH
+/*
+ * Function: timeStamp
+ * ---------------------
+ * Returns a 16-bit timestamp in 256us units from the Timer1_A overflow
+ * count and the upper byte of TA1R. An overflow still pending when
+ * called from an ISR is accounted for.
+ */
+unsigned int timeStamp(void)
+{
+    unsigned int epoch = TimerEpoch;
+    unsigned int ticks = TA1R;
+
+    if ((TA1CTL & TAIFG) && (ticks < 0x8000))
+    {
+        epoch++;                            // wrapped but overflow ISR not run yet
+    }
+    return (epoch << 8) | (ticks >> 8);
+}
+#endif
+
+#if CAPTURE
+/*
+ * Function: captureHeader
+ * ---------------------
+ * Announces the capture format so a host can check the version.
+ */
+void captureHeader(void)
+{
+    uartPutc('S');
+    uartPutc('C');
+    uartPutc('A');
+    uartPutc('P');
+    uartPutc(CAPTURE_VERSION);
+    uartPutc(CAPTURE_RECORD);
+}
+
+/*
+ * Function: captureSend
+ * ---------------------
+ * Sends the raw inputs consumed by this loop as one capture record.
+ */
+void captureSend(void)
+{
+    unsigned char raw[CAPTURE_RECORD - 2];
+    unsigned int time = timeStamp();
+    unsigned char check = 0;
+    unsigned int i;
+
+    raw[0] = Digits[FRAME_MODE];
+    raw[1] = time;
+    raw[2] = time >> 8;
+    raw[3] = RawTravel;
+    raw[4] = RawTravel >> 8;
+    for (i = 0; i < 8; i++)
+    {
+        raw[5 + 2 * i] = RawSamples[i];
+        raw[6 + 2 * i] = RawSamples[i] >> 8;
+    }
+
+    uartPutc(CAPTURE_SYNC);
+    for (i = 0; i < sizeof(raw); i++)
+    {
+        check ^= raw[i];
+        uartPutc(raw[i]);
+    }
+    uartPutc(check);
+}
+#endif
+
+#if TRACE
+/*
+ * Function: trace
+ * ---------------------
+ * Writes one record over the oldest entry of the ring buffer.
+ * Safe to call from both ISRs and the main loop.
+ */
+void trace(unsigned char id, unsigned char arg, unsigned int value)
+{
+    unsigned short sr = __get_SR_register();
+    struct TraceRecord *rec;
+
+    __disable_interrupt();
+    rec = &TraceBuf[TraceHead];
+    TraceHead = (TraceHead + 1) & (TRACE_RECORDS - 1);
+    if (TraceCount < TRACE_RECORDS)
+    {
+        TraceCount++;
+    }
+    rec->time = timeStamp();
+    rec->id = id;
+    rec->arg = arg;
+    rec->value = value;
+    if (sr & GIE)
+    {
+        __enable_interrupt();
+    }
+}
+
+/*
+ * Function: traceDump
+ * ---------------------
+ * Sends the trace oldest record first over the UART as one text line:
+ * '!' 'T' 'R', then in hex digits the version, the count, count 6-byte
+ * little-endian records (time, id, arg, value) and the XOR of all record
+ * bytes, then ';'. Sent as text, no byte of it starts a console request
+ * or a frame on the display MCU. The buffer is emptied afterwards.
+ */
+void traceDump(void)
+{
+    unsigned char check = 0;
+    unsigned int i, j, index;
+
+    while (IE2 & UCA0TXIE);                 // let the TX ISR finish its frame
+
+    __disable_interrupt();
+    index = (TraceHead - TraceCount) & (TRACE_RECORDS - 1);
+    uartPutc(FRAME_TEXT_START);
+    uartPutc('T');
+    uartPutc('R');
+    uartPutHex(TRACE_VERSION);
+    uartPutHex(TraceCount);
+    for (i = 0; i < TraceCount; i++)
+    {
+        struct TraceRecord *rec = &TraceBuf[(index + i) & (TRACE_RECORDS - 1)];
+        unsigned char raw[6];
+
+        raw[0] = rec->time;
+        raw[1] = rec->time >> 8;
+        raw[2] = rec->id;
+        raw[3] = rec->arg;
+        raw[4] = rec->value;
+        raw[5] = rec->value >> 8;
+        for (j = 0; j < sizeof(raw); j++)
+        {
+            check ^= raw[j];
+            uartPutHex(raw[j]);
+        }
+    }
+    uartPutHex(check);
+    uartPutc(FRAME_TEXT_END);
+    TraceCount = 0;
+    __bis_SR_register(GIE);                 // interrupts enabled
+}
+#endif
+
+#if ISR_PROFILE
+/*
+ * Function: profRecord
+ * ---------------------
+ * Accumulates one ISR execution time in Timer1_A ticks (SMCLK cycles).
+ */
+void profRecord(struct IsrProfile *prof, unsigned int ticks)
+{
+    unsigned int bin = 0;
+
+    prof->count++;
+    prof->total += ticks;
+    if ((prof->count == 1) || (ticks < prof->min))
+    {
+        prof->min = ticks;
+    }
+    if (ticks > prof->max)
+    {
+        prof->max = ticks;
+    }
+    while ((ticks >>= 1) != 0 && (bin < PROF_BINS - 1))
+    {
+        bin++;
+    }
+    prof->hist[bin]++;
+}
+
+/*
+ * Function: profLatency
+ * ---------------------
+ * Accumulates the delay between a timestamped hardware event and ISR entry.
+ */
+void profLatency(struct IsrProfile *prof, unsigned int ticks)
+{
+    prof->latCount++;
+    prof->latTotal += ticks;
+    if (ticks > prof->latMax)
+    {
+        prof->latMax = ticks;
+    }
+}
+
+/*
+ * Function: profDump
+ * ---------------------
+ * Writes one row of count, min/avg/max execution ticks, entry latency
+ * and log2 histogram per ISR over the UART, all inside one '!' ';' text
+ * line. Waits for the frame in flight so it is not interleaved.
+ */
+void profDump(void)
+{
+    unsigned int i, j;
+
+    while (IE2 & UCA0TXIE);                 // let the TX ISR finish its frame
+
+    uartPutc(FRAME_TEXT_START);
+    for (i = 0; i < PROF_COUNT; i++)
+    {
+        struct IsrProfile *prof = &IsrProfiles[i];
+
+        uartPuts(ProfNames[i]);
+        uartPuts(" n=");
+        uartPutNum(prof->count);
+        uartPuts(" min=");
+        uartPutNum(prof->min);
+        uartPuts(" avg=");
+        uartPutNum(prof->count ? prof->total / prof->count : 0);
+        uartPuts(" max=");
+        uartPutNum(prof->max);
+        uartPuts(" lat=");
+        uartPutNum(prof->latCount ? prof->latTotal / prof->latCount : 0);
+        uartPutc('/');
+        uartPutNum(prof->latMax);
+        uartPuts(" h=");
+        for (j = 0; j < PROF_BINS; j++)
+        {
+            uartPutNum(prof->hist[j]);
+            uartPutc((j < PROF_BINS - 1) ? ' ' : '\r');
+        }
+        uartPutc('\n');
+    }
+    uartPutc(FRAME_TEXT_END);
+}
+#endif
+
+/*
+ * Function: startup
+ * ---------------------
+ * Stops the watchdog and sets the clocks once for both roles, then reads
+ * pin 1.0 to determine which code function should be read on the
+ * microcontroller. Acts as a hardware flag. With LOOP_PROFILE set,
+ * Timer1_A starts counting first so LOOP_BOOT covers the whole boot.
+ *
+ * returns: 0 for the sensor MCU, HW_FLAG for the display MCU
+ */
+int startup(void)
+{
+    WDTCTL = WDTPW | WDTHOLD;               // stop watchdog timer
+#if LOOP_PROFILE
+    TA1CTL = TASSEL_2 + MC_2 + TACLR;       // boot time, SMCLK is near 1MHz before calibration too
+#endif
+    DCOCTL = 0;                             // Select lowest DCOx and MODx settings
+    if (CALBC1_MCLK != 0xFF)
+    {
+        BCSCTL1 = CALBC1_MCLK;              // MCLK at MCLK_MHZ
+        DCOCTL = CALDCO_MCLK;
+        ClockFast = DIVM_0 + SMCLK_DIV;     // SMCLK stays at 1MHz for UART and timers
+        ClockSlow = IDLE_DIV + SMCLK_DIV;
+        CLOCK_FAST();
+    }
+    else
+    {
+        BCSCTL1 = CALBC1_1MHZ;              // calibration erased, no bursts and DELAY_US runs long
+        DCOCTL = CALDCO_1MHZ;
+    }
+    watchdogStart();                        // supervised from here on
+
+    P1DIR = 0;
+    P1REN = HW_FLAG;                        // kept by both roles
+    P1OUT = 0;
+    return P1IN & HW_FLAG;
+}
+
+/*
+ * Function: triggerSensor
+ * ---------------------
+ * Toggles the trigger pin to be on for 10us. Calculates the distance value
+ * and averages the measurements to increase accurately.
+ */
+void triggerSensor(void)
+{
+    P2OUT |= TRIG_P;
+    DELAY_US(10);       // 10 us
+    P2OUT &= ~TRIG_P;
+
+    unsigned int val = 0;
+
+#if CAPTURE
+    RawTravel = Travel_time;
+    val = avg(data1, RawTravel / 58);
+#else
+    val = avg(data1, Travel_time / 58);
+#endif
+
+    if (val > 400)
+    {
+        Distance = 400;         // Maximum range of 400m
+    }
+    else
+    {
+        Distance = val;
+    }
+    TRACE_EVENT(TR_DISTANCE, 0, Distance);
+}
+
+/*
+ * Function: convertSensor
+ * ---------------------
+ * Encodes the sampled value into the frame to send, the mode is set by
+ * the caller. All four places are sent and the display blanks the
+ * leading zeros.
+ */
+void convertSensor(int readVal)
+{
+    frameEncode(Digits, readVal);
+    TRACE_EVENT(TR_FRAME, Digits[FRAME_MODE], readVal);
+}
+
+/*
+ * Function: setDistance
+ * ---------------------
+ * Sets the distance level for the speaker based off of selected threshold values
+ */
+void setDistance(unsigned int readVal)
+{
+    if (readVal == myPresetDistances[0])
+    {
+        Level = 5;
+    }
+    else if (readVal == myPresetDistances[1])
+    {
+        Level = 4;
+    }
+    else if (readVal == myPresetDistances[2])
+    {
+        Level = 3;
+    }
+    else if (readVal == myPresetDistances[3])
+    {
+        Level = 2;
+    }
+    else if (readVal == myPresetDistances[4])
+    {
+        Level = 1;
+    }
+    else
+    {
+        Level = 0;
+    }
+}
+
+/*
+ * Function: setSpeaker
+ * ---------------------
+ * Sets the interrupt timer values for the PWM to play certain notes based off of the distance level
+ */
+void setSpeaker()
+{
+    switch (Level)
+    {
+    case 1:
+        TA0CCR0 = 12134; // E2
+        TA0CCR1 = 6067;
+        break;
+    case 2:
+        TA0CCR0 = 3405; // D3
+        TA0CCR1 = 1702;
+        break;
+    case 3:
+        TA0CCR0 = 2272; // A4
+        TA0CCR1 = 1136;
+        break;
+    case 4:
+        TA0CCR0 = 1516; // E5
+        TA0CCR1 = 758;
+        break;
+    case 5:
+        TA0CCR0 = 1136; // A6
+        TA0CCR1 = 568;
+        break;
+    default:
+        TA0CCR0 = 0;
+        TA0CCR1 = 0;
+    }
+}
+
+// UART RX ISR to receive data
+#pragma vector = USCIAB0RX_VECTOR
+__interrupt void USCI0RX_ISR(void)
+{
+    char byte = UCA0RXBUF;
+
+    PROF_ENTER();
+    if ((ReqLen > 0) || ((byte == CMD_START) && (ReplyLen == 0)))
+    {                                       // console request, relayed by commandRequest()
+        if (ReqReady == TRUE)
+        {
+            // still holding the last one, drop this
+        }
+        else if (ReqLen >= CMD_LINE_SIZE)
+        {
+            ReqLen = 0;                     // too long, drop it
+        }
+        else
+        {
+            ReqLine[ReqLen++] = byte;
+            if (byte == CMD_END)
+            {
+                ReqReady = TRUE;
+            }
+        }
+    }
+    else if ((ReplyLen > 0) || (byte == FRAME_TEXT_START))
+    {                                       // sensor answer or diagnostics, never a frame or control character
+        linkRx(byte);                       // drops a partial frame
+        if (byte == FRAME_TEXT_END)
+        {
+            ReplyLen = 0;
+        }
+        else if ((ReplyLen < 2) && (++ReplyLen == 2) && ((byte == '+') || (byte == '-')))
+        {
+            ReplyStatus = byte;             // answer, diagnostics and dumps are passed over
+        }
+    }
+    else
+#if ISR_PROFILE
+    if (byte == PROF_DUMP_CHAR)
+    {
+        ProfDumpRequest = TRUE;
+    }
+    else
+#endif
+    if (byte == BRIGHT_CHAR)
+    {
+        BrightManual = (BrightManual + 1) % (BRIGHT_LEVELS + 1);   // auto, then each level
+    }
+    else
+#if LINK_STATS
+    if (byte == LINK_DUMP_CHAR)
+    {
+        LinkShown = (LinkShown + 1) % (LINK_METRICS + 1);
+        LinkDumpRequest = TRUE;
+    }
+    else
+#endif
+    {
+        switch (linkRx(byte))
+        {
+        case FRAME_DONE:
+            Flag = SAVE;                        // RX interrupt stays off until linkReceive()
+            break;
+        case FRAME_BAD:
+            LINK_COUNT(LINK_MALFORMED);         // short, overrun or failed check
+            break;
+        default:
+            break;
+        }
     }
+    PROF_EXIT(PROF_USCI0RX);
 }
 
 /*
  * Function: display
- * ----------------------
- * Enables and starts ADC conversion.
- * Return sampled value from ADC10MEM Register.
- *
- * returns: int value between 0-1023
+ * ---------------------
+ * Renders the received frame as text for the scan ISR:
+ *   'A'  X and Y tilt with sign and degree mark, scrolling
+ *   'C'  calibration positions captured so far
+ *   else the value without leading zeros, right aligned
+ * The outcome of a relayed command replaces it while ReqShown runs.
  */
 void display(void)
 {
-// use P2.0 - P2.7 for digit display
-// use P1.0 - P1.3 for place selection
-    char keyVal;
-    keyVal = Digits[4];
-    switch (keyVal)
+    unsigned int lit;
+    unsigned int i;
+
+    textClear();
+    if (ReqShown > 0)
     {
-    case '1':
-        P1OUT = BIT4;               // Set digit position on
-        displayDigit(Digits[0]);    // Display number
-        __delay_cycles(4000);
-        break;
-    case '2':
-        P1OUT = BIT4;
-        displayDigit(Digits[0]);
-        __delay_cycles(4000);
-        P1OUT = BIT6;
-        displayDigit(Digits[1]);
-        __delay_cycles(4000);
-        break;
-    case '3':
-        P1OUT = BIT4;
-        displayDigit(Digits[0]);
-        __delay_cycles(4000);
-        P1OUT = BIT6;
-        displayDigit(Digits[1]);
-        __delay_cycles(4000);
-        P1OUT = BIT7;
-        displayDigit(Digits[2]);
-        __delay_cycles(4000);
+        textPuts(ReqResult);
+        textShow();
+        return;
+    }
+    switch (Digits[FRAME_MODE])
+    {
+    case MODE_ANGLE:
+        textPutc('X');
+        textNumber(frameTilt(Digits, SIGN_X), 3, 0);
+        textPutc(DEGREE);
+        textPuts(" Y");
+        textNumber(frameTilt(Digits, SIGN_Y), 3, 0);
+        textPutc(DEGREE);
         break;
-    case '4':
-        P1OUT = BIT4;
-        displayDigit(Digits[0]);
-        __delay_cycles(2000);
-        P1OUT = BIT6;
-        displayDigit(Digits[1]);
-        __delay_cycles(2000);
-        P1OUT = BIT7;
-        displayDigit(Digits[2]);
-        __delay_cycles(2000);
-        P1OUT = BIT5;
-        displayDigit(Digits[3]);
-        __delay_cycles(4000);
+    case MODE_CAL:
+        textPuts("CAL");
+        textPutc(Digits[0]);
         break;
     default:
-        P1OUT = 0x00;
+        lit = litDigits(Digits);
+        for (i = DIGIT_COUNT; i > 0; i--)
+        {
+            textPutc((i <= lit) ? Digits[i - 1] : ' ');
+        }
     }
+    textShow();
 }
 
 /*
- * Function: displayDigit
- * --------------------
- * Based on the passed int value, assign output port P2.0-P2.6
- * to display the corresponding number
- *
- * returns: void
+ * Function: segmentCode
+ * ---------------------
+ * Returns the P2OUT pattern showing the given character, blank for
+ * characters without one.
  */
-void displayDigit(char val)
+unsigned char segmentCode(char val)
 {
     switch (val)
     {                       // Use char to select display bit value
     case '0':
-        P2OUT = ZERO;       // Set pins to display value
-        break;
+        return ZERO;       // Segments low to light them
     case '1':
-        P2OUT = ONE;
-        break;
+        return ONE;
     case '2':
-        P2OUT = TWO;
-        break;
+        return TWO;
     case '3':
-        P2OUT = THREE;
-        break;
+        return THREE;
     case '4':
-        P2OUT = FOUR;
-        break;
+        return FOUR;
     case '5':
-        P2OUT = FIVE;
-        break;
+        return FIVE;
     case '6':
-        P2OUT = SIX;
-        break;
+        return SIX;
     case '7':
-        P2OUT = SEVEN;
-        break;
+        return SEVEN;
     case '8':
-        P2OUT = EIGHT;
-        break;
+        return EIGHT;
     case '9':
-        P2OUT = NINE;
+        return NINE;
+    case '-':
+        return LIT(_G);
+    case DEGREE:
+        return LIT(_A + _B + _F + _G);
+    case 'A':
+        return LIT(_A + _B + _C + _E + _F + _G);
+    case 'C':
+        return LIT(_A + _D + _E + _F);
+    case 'd':
+        return LIT(_B + _C + _D + _E + _G);
+    case 'E':
+        return LIT(_A + _D + _E + _F + _G);
+    case 'L':
+        return LIT(_D + _E + _F);
+    case 'n':
+        return LIT(_C + _E + _G);
+    case 'o':
+        return LIT(_C + _D + _E + _G);
+    case 'r':
+        return LIT(_E + _G);
+    case 'X':
+        return LIT(_B + _C + _E + _F + _G);     // same as H
+    case 'Y':
+        return LIT(_B + _C + _D + _F + _G);
+    default:
+        return SEG_BLANK;
+    }
+}
+
+/*
+ * Function: textClear
+ * ---------------------
+ * Starts a new readout in the strip the scan ISR is not showing.
+ */
+void textClear(void)
+{
+    TextLen = 0;
+}
+
+/*
+ * Function: textPutc
+ * ---------------------
+ * Appends one character, a '.' lights the decimal point of the one
+ * before it instead. Characters past the strip are dropped.
+ */
+void textPutc(char c)
+{
+    if ((c == '.') && (TextLen > 0))
+    {
+        TextStrip[TextLen - 1] &= ~_DP;
+    }
+    else if (TextLen < STRIP_SIZE - SCROLL_GAP)
+    {
+        TextStrip[TextLen++] = segmentCode(c) | _DP;    // decimal point off
+    }
+}
+
+void textPuts(const char *str)
+{
+    while (*str)
+    {
+        textPutc(*str++);
+    }
+}
+
+/*
+ * Function: textNumber
+ * ---------------------
+ * Appends a signed value as a field of at least width places, right
+ * aligned, with the decimal point ahead of the last decimals digits.
+ */
+void textNumber(int value, unsigned int width, unsigned int decimals)
+{
+    char buf[NUMBER_WIDTH];
+    unsigned int mag = (value < 0) ? -value : value;
+    unsigned int n = 0;
+
+    do
+    {
+        buf[n++] = (mag % 10) + 48;
+        mag /= 10;
+    } while ((mag != 0) || (n <= decimals));    // at least one digit ahead of the point
+    if (value < 0)
+    {
+        buf[n++] = '-';
+    }
+    while ((n < width) && (n < NUMBER_WIDTH))
+    {
+        buf[n++] = ' ';
+    }
+
+    while (n > 0)
+    {
+        n--;
+        textPutc(buf[n]);
+        if ((decimals > 0) && (n == decimals))
+        {
+            textPutc('.');
+        }
+    }
+}
+
+/*
+ * Function: textShow
+ * ---------------------
+ * Hands the built strip to the scan ISR. A strip that fits is right
+ * aligned, a longer one gets a gap so its end and start do not run
+ * together. Scrolling restarts only when the length changes, so a
+ * readout updated every frame keeps moving.
+ */
+void textShow(void)
+{
+    unsigned char *built;
+    unsigned int i;
+
+    if (TextLen > DIGIT_COUNT)
+    {
+        for (i = 0; i < SCROLL_GAP; i++)
+        {
+            TextStrip[TextLen++] = SEG_BLANK;
+        }
+    }
+    else
+    {
+        unsigned int pad = DIGIT_COUNT - TextLen;
+
+        for (i = DIGIT_COUNT; i > pad; i--)
+        {
+            TextStrip[i - 1] = TextStrip[i - 1 - pad];
+        }
+        for (i = 0; i < pad; i++)
+        {
+            TextStrip[i] = SEG_BLANK;
+        }
+        TextLen = DIGIT_COUNT;
+    }
+
+    __disable_interrupt();
+    built = TextStrip;
+    TextStrip = ShownStrip;
+    ShownStrip = built;
+    if (ShownLen != TextLen)
+    {
+        ShownLen = TextLen;
+        ScrollPos = 0;
+        ScrollTick = 0;
+    }
+    __enable_interrupt();
+}
+
+/*
+ * Function: brightnessSet
+ * ---------------------
+ * Selects a brightness level, 0-7, and works out the lit ticks of every
+ * place from it and the place's duty. Kept out of the scan ISR, the G2
+ * has no hardware multiplier.
+ */
+void brightnessSet(unsigned int level)
+{
+    unsigned int i;
+
+    Brightness = level;
+    for (i = 0; i < DIGIT_COUNT; i++)
+    {
+        unsigned int on = (BrightTicks[level] * DigitDuty[i]) >> DUTY_SHIFT;
+
+        if (on < SCAN_MIN_ON)
+        {
+            on = SCAN_MIN_ON;
+        }
+        else if (on > SCAN_TICKS - SCAN_MIN_ON)
+        {
+            on = SCAN_TICKS - SCAN_MIN_ON;  // off again before the next place starts
+        }
+        OnTicks[i] = on;
+    }
+}
+
+/*
+ * Function: dutySet
+ * ---------------------
+ * Sets the duty of one place, 0 the rightmost, in 1/DUTY_FULL of the
+ * level's on time and applies it at the current level.
+ */
+void dutySet(unsigned int place, unsigned int duty)
+{
+    DigitDuty[place] = duty;
+    if (Brightness < BRIGHT_LEVELS)
+    {
+        brightnessSet(Brightness);
+    }
+}
+
+/*
+ * Function: brightnessPoll
+ * ---------------------
+ * Applies a level chosen over the UART, otherwise the one the light
+ * sensor asks for.
+ */
+void brightnessPoll(void)
+{
+    unsigned int level;
+
+    if (BrightManual)
+    {
+        level = BrightManual - 1;
+    }
+    else
+    {
+#if AUTO_DIM
+        level = Brightness;
+        if ((Brightness >= BRIGHT_LEVELS) || ((ScanFrames - AmbientFrame) >= AMBIENT_FRAMES))
+        {
+            AmbientFrame = ScanFrames;
+            level = ambientLevel();
+        }
+#else
+        level = BRIGHT_DEFAULT;
+#endif
+    }
+    if (level != Brightness)
+    {
+        brightnessSet(level);
+    }
+}
+
+#if AUTO_DIM
+/*
+ * Function: ambientLevel
+ * ---------------------
+ * Samples the light sensor, adds it to the running average and maps the
+ * average to a brightness level. The level only moves once the average
+ * is AMBIENT_HYST counts into the next band, so a reading sitting on a
+ * band edge does not flicker.
+ *
+ * returns: brightness level, 0-7
+ */
+unsigned int ambientLevel(void)
+{
+    unsigned int ambient;
+
+    ADC10CTL0 = ADC10SHT_2 + ADC10ON;       // VCC reference, 16 clock sample
+    ADC10CTL0 |= ENC + ADC10SC;
+    while (ADC10CTL1 & ADC10BUSY);
+    AmbientSum += ADC10MEM - (AmbientSum >> AMBIENT_SHIFT);
+    ADC10CTL0 &= ~ENC;
+    ADC10CTL0 = 0;                          // ADC off until the next sample
+
+    ambient = AmbientSum >> AMBIENT_SHIFT;
+    if ((Brightness >= BRIGHT_LEVELS)
+            || ((ambient > AMBIENT_HYST) && (((ambient - AMBIENT_HYST) >> AMBIENT_BAND) > Brightness))
+            || (((ambient + AMBIENT_HYST) >> AMBIENT_BAND) < Brightness))
+    {
+        return ambient >> AMBIENT_BAND;
+    }
+    return Brightness;
+}
+#endif
+
+/*
+ * Timer0_A CCR1/CCR2 ISR, display MCU only. CCR1 starts the slot of the
+ * next place: its segments are set while every digit is off, then its
+ * digit is lit and CCR2 is set to turn it off again. A dark place is not
+ * lit at all. Each place shows its window position of the text strip and
+ * a strip longer than the display scrolls once every SCROLL_FRAMES.
+ */
+#pragma vector = TIMER0_A1_VECTOR
+__interrupt void TIMER0_A1_ISR(void)
+{
+    static unsigned int place = 0;
+    unsigned int start, i;
+    unsigned char pattern;
+
+    PROF_ENTER();
+    switch (TA0IV)
+    {
+    case TA0IV_TACCR1:
+        start = TA0CCR1;
+        TA0CCR1 += SCAN_TICKS;
+        place = (place + 1) & (DIGIT_COUNT - 1);
+        if (place == 0)
+        {
+            ScanFrames++;
+            if ((ShownLen > DIGIT_COUNT) && (++ScrollTick >= SCROLL_FRAMES))
+            {
+                ScrollTick = 0;
+                ScrollPos = (ScrollPos + 1 < ShownLen) ? ScrollPos + 1 : 0;
+            }
+            __bic_SR_register_on_exit(LPM0_bits);   // main loop runs once per frame
+        }
+        i = ScrollPos + (DIGIT_COUNT - 1) - place;  // place 0 is the rightmost
+        if (i >= ShownLen)
+        {
+            i -= ShownLen;
+        }
+        pattern = ShownStrip[i];
+        if (pattern != SEG_BLANK)
+        {
+            P2OUT = pattern;
+            P1OUT = DigitSelect[place];
+            TA0CCR2 = start + OnTicks[place];
+            TA0CCTL2 = CCIE;
+            if ((TA0R - start) >= OnTicks[place])
+            {
+                P1OUT = 0x00;               // already past the off time
+                TA0CCTL2 = 0;
+            }
+        }
+        break;
+    case TA0IV_TACCR2:
+        P1OUT = 0x00;                       // digit off for the rest of the slot
+        TA0CCTL2 = 0;
         break;
+#if LINK_STATS
+    case TA0IV_TAIFG:
+        LinkEpoch++;                        // extends frame arrival times
+        break;
+#endif
     default:
-        P2OUT = ~0x00;
+        break;
+    }
+    PROF_EXIT(PROF_TIMER0_A1);
+}
+
+// Timer1_A CCR0 ISR, software UART receiver for the command channel
+#pragma vector = TIMER1_A0_VECTOR
+__interrupt void TIMER1_A0_ISR(void)
+{
+    if (TA1CCTL0 & CAP)
+    {                                       // start bit edge captured
+        TA1CCR0 += CMD_BIT_TICKS + (CMD_BIT_TICKS / 2);   // middle of data bit 0
+        TA1CCTL0 = SCS + CCIS_1 + CCIE;     // compare mode, SCCI latches P2.3
+        CmdBits = 0;
+        CmdByte = 0;
+    }
+    else
+    {
+        CmdByte >>= 1;                      // LSB first
+        if (TA1CCTL0 & SCCI)
+        {
+            CmdByte |= 0x80;
+        }
+        if (++CmdBits < 8)
+        {
+            TA1CCR0 += CMD_BIT_TICKS;
+        }
+        else
+        {
+            if (((CmdHead + 1) & (CMD_QUEUE_SIZE - 1)) != CmdTail)
+            {
+                CmdQueue[CmdHead] = CmdByte;
+                CmdHead = (CmdHead + 1) & (CMD_QUEUE_SIZE - 1);
+            }
+            TA1CCTL0 = SCS + CM_2 + CCIS_1 + CAP + CCIE;  // wait for the next start bit
+        }
     }
 }
 
 /*
- * ISR: Timer0 A0 Interrupt service routine
+ * ISR: Timer1 A1 Interrupt service routine
  * --------------------
  * if rising edge -> capture the timer register when pulse starts
  * else if falling edge -> capture the timer register when pulse ends
+ * CCR2 -> debounce tick while a button is down
  */
 #pragma vector = TIMER1_A1_VECTOR
 __interrupt void TIMER1_A1_ISR(void)
 {
+    PROF_ENTER();
     Edge = CCI;
     switch (TA1IV)
     {
@@ -569,8 +2281,12 @@ __interrupt void TIMER1_A1_ISR(void)
         break;
     case 10:
         // Don't sample if overflowed
+#if TIMER_EPOCH
+        TimerEpoch++;                       // extends timeStamp() past the wrap
+#endif
         break;
     case TA1IV_TACCR1:
+        PROF_LATENCY(PROF_TIMER1_A1, TA1CCR1);  // capture time to service time
         if (TA1CCTL1 & Edge)
         { // start timer
             Start = TA1CCR1;
@@ -579,49 +2295,40 @@ __interrupt void TIMER1_A1_ISR(void)
         { // stop timer
             End = TA1CCR1;
             Travel_time = End - Start; // Calculate the travel time
+            TRACE_EVENT(TR_ECHO, 0, Travel_time);
+        }
+        break;
+    case TA1IV_TACCR2:
+        TA1CCR2 += DEBOUNCE_TICKS;          // next debounce tick
+        if (debounce() == 0)
+        {                                   // all buttons released, back to edge interrupts
+            TA1CCTL2 &= ~CCIE;
+            P2IFG &= ~BTN_MASK;
+            P2IE |= BTN_MASK;
         }
         break;
     default:
         break;
     }
     TACTL &= ~CCIFG; // clear interrupt flag
+    PROF_EXIT(PROF_TIMER1_A1);
 }
 
 /*
  * ISR: Port 2 Interrupt service routine
  * --------------------
- * if rising edge -> capture the timer register when pulse starts
- * else if falling edge -> capture the timer register when pulse ends
+ * A button edge hands the buttons over to the debounce tick on
+ * Timer1_A CCR2, which samples them until every button is released.
  */
 #pragma vector = PORT2_VECTOR
 __interrupt void PORT2_ISR(void)
 {
-    if ((P2IFG & BIT4))
-    {
-        if (myPresetDistancesIndex == 4)
-        {
-            myPresetDistancesIndex = 0;
-        }
-        else
-        {
-            myPresetDistancesIndex++;
-        }
-
-        P2IFG &= ~BIT4;                     // clear P2.4 interrupt flag
-    }
-
-    if (P2IFG & BIT5)
-    {
-        if (System == DISTANCE)
-        {
-            System = ANGLE;
-        }
-        else
-        {
-            System = DISTANCE;
-        }
-        P2IFG &= ~BIT5;                     // clear P2.5 interrupt flag
-    }
+    PROF_ENTER();
+    P2IE &= ~BTN_MASK;                      // ignore bounces while debouncing
+    P2IFG &= ~BTN_MASK;                     // clear button interrupt flags
+    TA1CCR2 = TA1R + DEBOUNCE_TICKS;
+    TA1CCTL2 = CCIE;                        // start the debounce tick
+    PROF_EXIT(PROF_PORT2);
 }
 
 /*
@@ -631,25 +2338,20 @@ __interrupt void PORT2_ISR(void)
  */
 void portInit0(void)
 {
-    WDTCTL = WDTPW | WDTHOLD;               // stop watchdog timer
-    DCOCTL = 0;                             // Select lowest DCOx and MODx settings
-    BCSCTL1 = CALBC1_1MHZ;                  // Set DCO
-    DCOCTL = CALDCO_1MHZ;
-
     /* Configure UART */
-    P1SEL = BIT2;                           // P1.2=TXD
-    P1SEL2 = BIT2;                          // P1.2=TXD
-    UCA0CTL1 |= UCSSEL_2;                   // SMCLK
-    UCA0BR0 = 104;                          // 1MHz 9600
-    UCA0BR1 = 0;                            // 1MHz 9600
-    UCA0MCTL = UCBRS0;                      // Modulation UCBRSx = 1
-    UCA0CTL1 &= ~UCSWRST;                   // **Initialize USCI state machine**
-
-    /* Set GPIO Pin */
-    P2DIR |= BIT3 + BIT6;                   // Set P1.6 as speaker driver
-    P2SEL |= BIT6;
-    P2SEL &= ~BIT7;
-    P2SEL2 &= BIT6 + BIT7;                  // turn off XIN to enable P2.6
+    P1SEL = SENSOR_P1SEL;                   // P1.2=TXD
+    P1SEL2 = SENSOR_P1SEL;
+    uartInit();                             // 9600 from SMCLK
+
+    /* Set GPIO Pins: trigger, spare, speaker, echo and buttons */
+    P2OUT = SENSOR_P2OUT;
+    P2REN = SENSOR_P2REN;
+    P2DIR = SENSOR_P2DIR;
+    P2SEL = SENSOR_P2SEL;                   // echo capture, speaker PWM, XIN off
+    P2SEL2 = 0;
+    P2IES = SENSOR_P2IES;
+    P2IFG = 0x00;                           // edge select can set flags
+    P2IE = BTN_MASK;
 
     /* Configure PWM Timer */
     TACTL = TASSEL_2 + MC_1;                // SMCLK, upmode
@@ -657,38 +2359,19 @@ void portInit0(void)
     TA0CCTL1 = OUTMOD_7;                    // CCR0 reset/set
     TA0CCR1 = 6067;                         // PWM Duty Cycle
 
-    /* Configure Ultrasonic */
-    P2DIR |= TRIG_P;                        // Set P2.0 output as trigger
-    P2OUT &= ~TRIG_P;                       // Set P2.0 off
-    P2DIR &= ~ECHO_P;                       // Set P2.1 input as echo / 1A3_CCI1A
-    P2SEL |= ECHO_P;
-    P2REN |= ECHO_P;                        // Enable resistor
-    P2OUT &= ~ECHO_P;                       // Pull-down mode
-
-    /* Configure Ultrasonic Timer */
-    TA1CTL = MC_0;
-    TA1CCTL1 |= SCS + CM_3 + CCIS_0 + CAP + CCIE; // synchronous, rising/falling edge, compare input select, capture mode, interrupt enable
-    TA1CTL |= TASSEL_2 + MC_2;
-
-    /*  Configure Button as interrupt  */
-    // SYSTEM SW
-    P2REN |= BIT4;
-    P2OUT |= BIT4;
-    P2IE |= BIT4;                           // Set button interrupt to P2.4
-    P2IES &= ~(BIT4);
-
-    // MODE SW
-    P2REN |= BIT5;
-    P2OUT |= BIT5;
-    P2IE |= BIT5;
-    P2IES &= ~(BIT5);
-    P2IFG = 0x00;                  // clear interrupt flags
-    P2OUT &= ~BIT3;
+    /* Configure Ultrasonic Timer, stopped since reset or counting LOOP_BOOT */
+    TA1CCTL1 = SCS + CM_3 + CCIS_0 + CAP + CCIE; // synchronous, rising/falling edge, compare input select, capture mode, interrupt enable
+    TA1CCTL0 = SCS + CM_2 + CCIS_1 + CAP + CCIE; // command start bit, falling edge on P2.3
+#if TIMER_EPOCH
+    TA1CTL = TASSEL_2 + MC_2 + TAIE + (TA1CTL & TAIFG); // no TACLR, an overflow during boot stays pending
+#else
+    TA1CTL = TASSEL_2 + MC_2;
+#endif
 
     /* Configure ADC Channels */
     ADC10CTL1 = INCH_7 + ADC10DIV_0 + CONSEQ_3 + SHS_0;
     ADC10CTL0 = SREF_0 + ADC10SHT_2 + MSC + ADC10ON;
-    ADC10AE0 = BIT7 + BIT6 + BIT5 + BIT4 + BIT3 + BIT1;
+    ADC10AE0 = ADC_PINS;
     ADC10DTC1 = 8;
 
     __bis_SR_register(GIE); // interrupts enabled
@@ -701,25 +2384,32 @@ void portInit0(void)
  */
 void portInit1(void)
 {
-    WDTCTL = WDTPW | WDTHOLD;   // stop watchdog timer
-    DCOCTL = 0;                 // Select lowest DCOx and MODx settings
-    BCSCTL1 = CALBC1_1MHZ;      // Set DCO
-    DCOCTL = CALDCO_1MHZ;
-
     /* Configure UART */
-    P1SEL = BIT1 + BIT2;        // P1.1=RXD
-    P1SEL2 = BIT1 + BIT2;       // P1.1=RXD
-    UCA0CTL1 |= UCSSEL_2;       // SMCLK
-    UCA0BR0 = 104;              // 1MHz 9600
-    UCA0BR1 = 0;                // 1MHz 9600
-    UCA0MCTL = UCBRS0;          // Modulation UCBRSx = 1
-    UCA0CTL1 &= ~UCSWRST;       // **Initialize USCI state machine**
+    P1SEL = DISPLAY_P1SEL;      // P1.1=RXD
+    P1SEL2 = DISPLAY_P1SEL;
+    uartInit();                 // 9600 from SMCLK
     IE2 |= UCA0RXIE;            // Enable USCI_A0 RX interrupt
 
+#if ISR_PROFILE
+    TA1CTL = TASSEL_2 + MC_2;   // free-running SMCLK timestamp for ISR profiling
+#endif
+#if LINK_STATS
+    TA0CTL = TASSEL_2 + ID_3 + MC_2 + TAIE; // 8us ticks for the digit scan and frame arrival times
+#else
+    TA0CTL = TASSEL_2 + ID_3 + MC_2;    // 8us ticks for the digit scan
+#endif
+    TA0CCR1 = TA0R + SCAN_TICKS;
+    TA0CCTL1 = CCIE;                    // first scan slot
+
     /* Configure GPIO */
-    P1DIR |= (BIT6 + BIT7 + BIT4 + BIT5);   // set P1.2-P1.5 pins to output
-    P2DIR |= 0x7F;                          // set P2 pins to output
+    P1DIR = DISPLAY_P1DIR;                  // digit place selects
     P2OUT = 0x00;                           // reset all P2 output pins to clear 7-seg
-    P2SEL &= ~(BIT6 + BIT7);                // turn off XIN to enable P2.6
+    P2DIR = DISPLAY_P2DIR;                  // segment drivers
+    P2SEL = DISPLAY_P2SEL;                  // turn off XIN to enable P2.6
+#if AUTO_DIM
+    ADC10CTL1 = AMBIENT_INCH + ADC10DIV_3;  // light sensor, ADC10CLK/4
+    ADC10AE0 = AMBIENT_P;
+#endif
+    CLOCK_SLOW();                           // the display only multiplexes and waits
     __bis_SR_register(GIE);                 // interrupts enabled
 }
@@ -0,0 +1,43 @@
+/*
+ * adc.c
+ *
+ * ADC10 oversampling and the hysteresis that keeps a reading from
+ * flickering between two values, see adc.h.
+ */
+
+#include <msp430.h>
+#include "adc.h"
+
+/*
+ * Function: adcOversample
+ * ---------------------
+ * Sums ADC_SAMPLES conversions from the ADC10MEM register and decimates
+ * the sum down to ADC_RES_BITS of resolution.
+ *
+ * returns: reading between 0 and ADC_MAX
+ */
+unsigned int adcOversample(void)
+{
+    unsigned int sum = 0;
+    unsigned int i;
+
+    for (i = 0; i < ADC_SAMPLES; i++)
+    {
+        ADC10CTL0 |= ENC + ADC10SC;                     // enable and start conversion
+        while ((ADC10CTL1 & ADC10BUSY) == 0x01);        // wait until sample operation is complete
+        sum += ADC10MEM;
+    }
+    return sum >> ADC_SHIFT;                            // decimate the sum, keeping the extra bits
+}
+
+/*
+ * Function: adcHold
+ * ---------------------
+ * returns: old while val is less than band away from it, otherwise val
+ */
+unsigned int adcHold(unsigned int val, unsigned int old, unsigned int band)
+{
+    unsigned int difference = (val > old) ? (val - old) : (old - val);
+
+    return (difference < band) ? old : val;
+}
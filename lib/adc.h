@@ -0,0 +1,31 @@
+/*
+ * adc.h
+ *
+ * ADC10 oversampling: 4^n summed conversions decimated by a right shift
+ * give n extra bits. The caller selects the channel and ADC10CLK.
+ *
+ * ADC_RES_BITS is one setting for the whole build, passed by the Makefile
+ * to lib/ and every app alike, so the library and its callers cannot
+ * disagree on ADC_MAX and ADC_COUNTS().
+ */
+
+#ifndef LIB_ADC_H
+#define LIB_ADC_H
+
+#ifndef ADC_RES_BITS
+#error "ADC_RES_BITS is set for the whole build, make ADC_RES_BITS=n"
+#endif
+#define ADC_SAMPLES_LOG2    6                           // 2^6 = 64 samples per reading (sum fits 16 bits)
+#define ADC_SAMPLES         (1 << ADC_SAMPLES_LOG2)
+#define ADC_SHIFT           (ADC_SAMPLES_LOG2 - (ADC_RES_BITS - 10))
+#define ADC_MAX             ((1 << ADC_RES_BITS) - 1)   // full scale reading
+#define ADC_COUNTS(n)       ((n) << (ADC_RES_BITS - 10))    // 10-bit counts at ADC_RES_BITS
+
+#if (ADC_RES_BITS < 10) || (2 * (ADC_RES_BITS - 10) > ADC_SAMPLES_LOG2) || (ADC_SAMPLES_LOG2 > 6)
+#error "ADC_RES_BITS needs 4^(ADC_RES_BITS-10) samples and at most 64 samples fit the 16-bit sum"
+#endif
+
+unsigned int adcOversample(void);
+unsigned int adcHold(unsigned int val, unsigned int old, unsigned int band);
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * board.h
+ *
+ * Pin map of the level sensor board, the same for both MCUs: a strap on
+ * P1.0 selects the role, the sensor MCU drives the ultrasonic sensor,
+ * speaker and buttons and the display MCU the four digits. The lab
+ * boards of the other apps are wired as lib/display.h describes.
+ * Include after <msp430.h>.
+ *
+ * The port register images are written once by the role's port setup.
+ * The *_ROLES lists name every pin role of a port for the pin conflict
+ * check in tests/test_board.c; a new pin goes into its list as well.
+ */
+
+#ifndef LIB_BOARD_H
+#define LIB_BOARD_H
+
+#define HW_FLAG     BIT0            // P1.0 strap selects the role, pulled down on the sensor
+#define UART_RXD    BIT1            // P1.1 UCA0RXD, display MCU only
+#define UART_TXD    BIT2            // P1.2 UCA0TXD
+
+/* sensor MCU (mcu 0) */
+#define ADC_PINS    (BIT7 + BIT6 + BIT5 + BIT4 + BIT3 + BIT1)   // P1 analog inputs
+#define TRIG_P      (BIT0)          // P2.0 ultrasonic trigger
+#define ECHO_P      (BIT1)          // P2.1 ultrasonic echo, TA1 CCI1A
+#define CMD_RXD     (BIT3)          // P2.3 command input, TA1 CCI0B software UART
+#define BTN_PRESET  BIT4            // P2.4 cycles preset distance / captures calibration
+#define BTN_MODE    BIT5            // P2.5 switches DISTANCE / ANGLE
+#define SPEAKER_P   (BIT6)          // P2.6 TA0.1 PWM, XIN function disabled
+
+/* display MCU (mcu 1), segments are lit low */
+#define DIGIT_1     BIT4            // P1.4 ones place select
+#define DIGIT_2     BIT6            // P1.6 tens place select
+#define DIGIT_3     BIT7            // P1.7 hundreds place select
+#define DIGIT_4     BIT5            // P1.5 thousands place select
+#define DIGIT_PINS  (DIGIT_1 + DIGIT_2 + DIGIT_3 + DIGIT_4)
+#define _A BIT6
+#define _B BIT4
+#define _C BIT1
+#define _D BIT0
+#define _E BIT3
+#define _F BIT5
+#define _G BIT2
+#define _DP BIT7
+#define SEG_PINS    (_A + _B + _C + _D + _E + _F + _G)        // P2.0-P2.6
+#define DP_P        _DP             // P2.7 decimal point, XOUT function off
+#define AMBIENT_P   BIT3            // P1.3 A3 light sensor divider, reads higher in brighter light
+#define AMBIENT_INCH INCH_3
+
+/* Port register images, written once by portInit0 and portInit1 */
+#define SENSOR_P1SEL    UART_TXD
+#define SENSOR_P2DIR    (TRIG_P + SPEAKER_P)
+#define SENSOR_P2SEL    (ECHO_P + CMD_RXD + SPEAKER_P)
+#define SENSOR_P2REN    (ECHO_P + CMD_RXD + BTN_PRESET + BTN_MODE)
+#define SENSOR_P2OUT    (CMD_RXD + BTN_PRESET + BTN_MODE)   // command idle and button pull-ups, echo pull-down, outputs low
+#define SENSOR_P2IES    (BTN_PRESET + BTN_MODE)             // falling edge on press
+
+#define DISPLAY_P1DIR   DIGIT_PINS
+#define DISPLAY_P1SEL   (UART_RXD + UART_TXD)
+#define DISPLAY_P2DIR   (SEG_PINS + DP_P)
+#define DISPLAY_P2SEL   0                                   // XIN/XOUT off, P2.6 as GPIO
+
+/* Pin roles per MCU and port */
+#define SENSOR_P1_ROLES(ROLE)   ROLE(HW_FLAG) ROLE(UART_TXD) ROLE(ADC_PINS)
+#define SENSOR_P2_ROLES(ROLE)   ROLE(TRIG_P) ROLE(ECHO_P) ROLE(CMD_RXD) ROLE(BTN_PRESET) ROLE(BTN_MODE) ROLE(SPEAKER_P)
+#define DISPLAY_P1_ROLES(ROLE)  ROLE(HW_FLAG) ROLE(UART_RXD) ROLE(UART_TXD) ROLE(AMBIENT_P) \
+                                ROLE(DIGIT_1) ROLE(DIGIT_2) ROLE(DIGIT_3) ROLE(DIGIT_4)
+#define DISPLAY_P2_ROLES(ROLE)  ROLE(_A) ROLE(_B) ROLE(_C) ROLE(_D) ROLE(_E) ROLE(_F) ROLE(_G) ROLE(DP_P)
+
+#endif
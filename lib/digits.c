@@ -0,0 +1,53 @@
+/*
+ * digits.c
+ *
+ * Decimal place splitting and leading zero blanking shared by the
+ * display and UART frame code.
+ */
+
+#include "digits.h"
+
+/*
+ * Function: splitDigits
+ * ---------------------
+ * Stores the ones, tens, hundreds and thousands place of value in
+ * place[0] to place[3]. Values above 9999 keep their lower four places.
+ *
+ * returns: number of significant places, 1 to 4
+ */
+unsigned int splitDigits(unsigned int value, unsigned char *place)
+{
+    unsigned int count = 1;
+    unsigned int i;
+
+    for (i = 0; i < DIGIT_COUNT; i++)
+    {
+        place[i] = value % 10;
+        value /= 10;
+        if ((place[i] != 0) || (value != 0))
+        {
+            count = i + 1;
+        }
+    }
+    return count;
+}
+
+/*
+ * Function: litDigits
+ * ---------------------
+ * Counts the places of the ASCII digits digits[0] (ones) to digits[3]
+ * (thousands) that are lit once leading zeros are blanked. The ones
+ * place is always lit, so 0 shows as a single 0.
+ *
+ * returns: number of places to light, 1 to 4
+ */
+unsigned int litDigits(const char *digits)
+{
+    unsigned int count = DIGIT_COUNT;
+
+    while ((count > 1) && (digits[count - 1] == '0'))
+    {
+        count--;
+    }
+    return count;
+}
@@ -0,0 +1,16 @@
+/*
+ * digits.h
+ *
+ * Decimal place splitting and leading zero blanking shared by the
+ * display and UART frame code.
+ */
+
+#ifndef LIB_DIGITS_H
+#define LIB_DIGITS_H
+
+#define DIGIT_COUNT 4               // places on the 4 digit displays
+
+unsigned int splitDigits(unsigned int value, unsigned char *place);
+unsigned int litDigits(const char *digits);
+
+#endif
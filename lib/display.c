@@ -0,0 +1,65 @@
+/*
+ * display.c
+ *
+ * Segment patterns and polled multiplexing for the lab board displays,
+ * see display.h.
+ */
+
+#include <msp430.h>
+#include "display.h"
+#include "digits.h"
+
+/* a to g on bit 6 to bit 0, inverted because the display is common anode */
+static const unsigned char Segments[10] = {
+    (unsigned char) ~0x7E, (unsigned char) ~0x30, (unsigned char) ~0x6D, (unsigned char) ~0x79,
+    (unsigned char) ~0x33, (unsigned char) ~0x5B, (unsigned char) ~0x5F, (unsigned char) ~0x70,
+    (unsigned char) ~0x7F, (unsigned char) ~0x7B
+};
+
+/*
+ * Function: segmentDigit
+ * ---------------------
+ * returns: P2 pattern of digit 0 to 9, SEG_OFF for anything else
+ */
+unsigned char segmentDigit(unsigned int digit)
+{
+    return (digit < 10) ? Segments[digit] : SEG_OFF;
+}
+
+/*
+ * Function: displayDigit
+ * ---------------------
+ * Drives the segments of digit 0 to 9 on P2.0-P2.6, anything else
+ * blanks them.
+ */
+void displayDigit(unsigned int digit)
+{
+    P2OUT = segmentDigit(digit);
+}
+
+/*
+ * Function: displayScan
+ * ---------------------
+ * Multiplexes one pass over the ASCII digits[0] (ones) to digits[3]
+ * with place[i] the P1 pin of place i. Every place gets the same
+ * DIGIT_SLOT_CYCLES slot and is lit for DIGIT_ON_CYCLES of it, leading
+ * zero places stay dark, so brightness does not depend on how many
+ * digits are shown.
+ */
+void displayScan(const char *digits, const unsigned char *place)
+{
+    unsigned int lit = litDigits(digits);
+    unsigned int i;
+
+    for (i = 0; i < DIGIT_COUNT; i++)
+    {
+        if (i < lit)
+        {
+            displayDigit(digits[i] - '0');      // segments set while no digit is on
+            P1OUT = place[i];                   // Set digit position on
+        }
+        __delay_cycles(DIGIT_ON_CYCLES);
+        P1OUT = 0x00;
+        __delay_cycles(DIGIT_SLOT_CYCLES - DIGIT_ON_CYCLES);
+    }
+}
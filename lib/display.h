@@ -0,0 +1,20 @@
+/*
+ * display.h
+ *
+ * Common anode 4 digit display of the lab boards: segments a to g on
+ * P2.6 to P2.0, low to light, one P1 pin per place. The level sensor
+ * board is wired differently and has its own segment table.
+ */
+
+#ifndef LIB_DISPLAY_H
+#define LIB_DISPLAY_H
+
+#define SEG_OFF             0xFF                        // every segment dark
+#define DIGIT_SLOT_CYCLES   2500                        // 2.5ms per place at 1MHz, 100Hz refresh
+#define DIGIT_ON_CYCLES     2000                        // brightness, below DIGIT_SLOT_CYCLES
+
+unsigned char segmentDigit(unsigned int digit);
+void displayDigit(unsigned int digit);
+void displayScan(const char *digits, const unsigned char *place);
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * flash.c
+ *
+ * Information memory helpers for the calibration and reset records.
+ */
+
+#include <msp430.h>
+#include "flash.h"
+
+/*
+ * Function: flashChecksum
+ * ---------------------
+ * Returns the one's complement of the sum of the given number of words.
+ */
+unsigned int flashChecksum(const void *data, unsigned int words)
+{
+    const unsigned int *word = (const unsigned int *) data;
+    unsigned int sum = 0;
+    unsigned int i;
+
+    for (i = 0; i < words; i++)
+    {
+        sum += word[i];
+    }
+    return ~sum;
+}
+
+/*
+ * Function: flashWrite
+ * ---------------------
+ * Erases the information memory segment at dst and writes the given
+ * number of words into it. Needs SMCLK at 1MHz for the flash timing
+ * generator. The interrupt enable is restored to what it was on entry.
+ */
+void flashWrite(unsigned int *dst, const void *data, unsigned int words)
+{
+    const unsigned int *src = (const unsigned int *) data;
+    unsigned int gie = __get_SR_register() & GIE;
+    unsigned int i;
+
+    __disable_interrupt();
+    FCTL2 = FWKEY + FSSEL_2 + FN1;          // SMCLK/3 = 333kHz flash timing generator
+    FCTL3 = FWKEY;                          // clear LOCK
+    FCTL1 = FWKEY + ERASE;                  // segment erase
+    *dst = 0;                               // dummy write starts the erase
+#ifdef SIM_FLASH_ERASE
+    SIM_FLASH_ERASE(dst);                   // the host register stub cannot see the dummy write
+#endif
+    FCTL1 = FWKEY + WRT;                    // word write
+    for (i = 0; i < words; i++)
+    {
+        dst[i] = src[i];
+    }
+    FCTL1 = FWKEY;                          // clear WRT
+    FCTL3 = FWKEY + LOCK;                   // set LOCK
+    __bis_SR_register(gie);                 // interrupts back as they were
+}
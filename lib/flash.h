@@ -0,0 +1,22 @@
+/*
+ * flash.h
+ *
+ * Information memory helpers for the calibration and reset records.
+ */
+
+#ifndef LIB_FLASH_H
+#define LIB_FLASH_H
+
+/* information memory segments, 64 bytes each from D at 0x1000 up to A;
+ * the host register stub in sim/ maps them into host memory instead */
+#define INFO_D          0
+#define INFO_C          1
+#define INFO_B          2
+#ifndef INFO_SEG
+#define INFO_SEG(n)     ((void *) (0x1000 + 0x40 * (n)))
+#endif
+
+unsigned int flashChecksum(const void *data, unsigned int words);
+void flashWrite(unsigned int *dst, const void *data, unsigned int words);
+
+#endif
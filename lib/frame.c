@@ -0,0 +1,166 @@
+/*
+ * frame.c
+ *
+ * Encoder and receive state machine for the board link frames, see
+ * frame.h for the layout.
+ */
+
+#include "frame.h"
+#include "digits.h"
+
+static unsigned char frameCheck(const char *frame);
+
+/*
+ * Function: frameEncode
+ * ---------------------
+ * Stores the four places of value as ASCII digits, clears the signs and
+ * ends the frame. The mode and sequence bytes are left to the caller,
+ * which seals the frame once they are set.
+ */
+void frameEncode(char *frame, unsigned int value)
+{
+    unsigned char place[DIGIT_COUNT];
+    unsigned int i;
+
+    splitDigits(value, place);
+    for (i = 0; i < DIGIT_COUNT; i++)
+    {
+        frame[i] = place[i] + '0';
+    }
+    frame[FRAME_SIGNS] = SIGN_BASE;
+    frame[FRAME_END] = FRAME_END_CHAR;
+}
+
+/*
+ * Function: frameSeal
+ * ---------------------
+ * Stores the check of a frame whose other bytes are final.
+ */
+void frameSeal(char *frame)
+{
+    unsigned char check = frameCheck(frame);
+
+    frame[FRAME_CHECK] = CHECK_BASE + (check >> 4);
+    frame[FRAME_CHECK + 1] = CHECK_BASE + (check & 0x0F);
+}
+
+/*
+ * Function: frameCheck
+ * ---------------------
+ * returns: XOR of the bytes before the check
+ */
+static unsigned char frameCheck(const char *frame)
+{
+    unsigned char check = 0;
+    unsigned int i;
+
+    for (i = 0; i < FRAME_CHECK; i++)
+    {
+        check ^= frame[i];
+    }
+    return check;
+}
+
+/*
+ * Function: frameValue
+ * ---------------------
+ * returns: d3..d0 as a number, -1 when any of them is not a digit
+ */
+int frameValue(const char *frame)
+{
+    int value = 0;
+    int i;
+
+    for (i = DIGIT_COUNT - 1; i >= 0; i--)
+    {
+        if ((frame[i] < '0') || (frame[i] > '9'))
+        {
+            return -1;
+        }
+        value = value * 10 + (frame[i] - '0');
+    }
+    return value;
+}
+
+/*
+ * Function: frameSequence
+ * ---------------------
+ * returns: sequence 0 to SEQ_COUNT - 1, -1 for a bad sequence character
+ */
+int frameSequence(const char *frame)
+{
+    if ((frame[FRAME_SEQ] < SEQ_BASE) || (frame[FRAME_SEQ] >= SEQ_BASE + SEQ_COUNT))
+    {
+        return -1;
+    }
+    return frame[FRAME_SEQ] - SEQ_BASE;
+}
+
+/*
+ * Function: frameTilt
+ * ---------------------
+ * Reads the tilt of an ANGLE frame, axis SIGN_X for the X tilt in d3 d2
+ * or SIGN_Y for the Y tilt in d1 d0.
+ *
+ * returns: signed tilt in degrees
+ */
+int frameTilt(const char *frame, unsigned int axis)
+{
+    unsigned int tens = (axis == SIGN_X) ? 3 : 1;
+    int angle = (frame[tens] - '0') * 10 + (frame[tens - 1] - '0');
+
+    return ((frame[FRAME_SIGNS] - SIGN_BASE) & axis) ? -angle : angle;
+}
+
+/*
+ * Function: frameRx
+ * ---------------------
+ * Adds one received byte to frame. A ',' ends the frame, which is only
+ * complete when it lands on FRAME_END with a matching check; a shorter
+ * frame, one overrunning FRAME_END or one failing its check is reported
+ * and the next byte starts over. A text line is skipped whole, its
+ * FRAME_TEXT_START drops any partial frame.
+ *
+ * returns: FRAME_DONE when frame holds a complete frame, FRAME_BAD for a
+ *          short, overrun or corrupted frame, FRAME_TEXT for a byte of a
+ *          text line, otherwise FRAME_MORE
+ */
+enum FrameState frameRx(struct FrameRx *rx, char *frame, char byte)
+{
+    if (rx->text)
+    {
+        if (byte == FRAME_TEXT_END)
+        {
+            rx->text = 0;
+        }
+        return FRAME_TEXT;
+    }
+    if (byte == FRAME_TEXT_START)
+    {
+        rx->text = 1;
+        rx->index = 0;
+        return FRAME_TEXT;
+    }
+    if (rx->index >= FRAME_SIZE)
+    {
+        rx->index = 0;                      // no ',' where expected
+        return FRAME_BAD;
+    }
+    if (byte == FRAME_END_CHAR)
+    {
+        unsigned char check = frameCheck(frame);
+        enum FrameState state = FRAME_BAD;
+
+        if ((rx->index == FRAME_END) && (frame[FRAME_CHECK] == CHECK_BASE + (check >> 4))
+            && (frame[FRAME_CHECK + 1] == CHECK_BASE + (check & 0x0F)))
+        {
+            state = FRAME_DONE;
+        }
+        frame[FRAME_END] = FRAME_END_CHAR;
+        rx->index = 0;
+        return state;
+    }
+    frame[rx->index] = byte;
+    rx->index++;
+    return FRAME_MORE;
+}
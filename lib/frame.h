@@ -0,0 +1,61 @@
+/*
+ * frame.h
+ *
+ * Layout of the frames the sensor MCU sends the display MCU over the
+ * 9600 baud board link, with the encoder and the receive state machine
+ * shared by both boards and the host tools. Nothing here touches the
+ * hardware.
+ *
+ *   d0 d1 d2 d3 mode seq signs check_hi check_lo ','
+ *
+ * d0 is the ones place in ASCII, mode says how the display shows the
+ * digits, seq counts 'a' to 'p' and signs is '0' plus SIGN_X and SIGN_Y.
+ * The check is the XOR of the seven bytes before it, sent as two nibbles
+ * 'a' to 'p', so a frame with a bit error is rejected like a short one.
+ * Command answers, diagnostics and dumps share the link as text lines
+ * from FRAME_TEXT_START to FRAME_TEXT_END, which are never taken for
+ * frames.
+ */
+
+#ifndef LIB_FRAME_H
+#define LIB_FRAME_H
+
+#define FRAME_SIZE      10          // d0-d3, mode, sequence, signs, check, ','
+#define FRAME_MODE      4
+#define FRAME_SEQ       5
+#define FRAME_SIGNS     6
+#define FRAME_CHECK     7           // two bytes
+#define FRAME_END       9
+#define FRAME_END_CHAR  ','
+#define FRAME_TEXT_START '!'        // starts a text line
+#define FRAME_TEXT_END  ';'         // ends it
+
+#define SEQ_BASE        'a'         // frame sequence sent as 'a' to 'p'
+#define SEQ_COUNT       16          // power of two
+#define SIGN_BASE       '0'         // signs sent as '0' + SIGN_X + SIGN_Y
+#define SIGN_X          1           // ANGLE frames: X tilt is negative
+#define SIGN_Y          2           // ANGLE frames: Y tilt is negative
+#define CHECK_BASE      'a'         // check nibbles sent as 'a' to 'p'
+
+/* frame modes */
+#define MODE_DISTANCE   'D'         // distance in cm
+#define MODE_ANGLE      'A'         // X tilt in d3 d2, Y tilt in d1 d0, degrees
+#define MODE_PROFILE    'P'         // loop profile metric
+#define MODE_CAL        'C'         // calibration positions captured
+#define MODE_VALUE      'V'         // plain reading
+
+enum FrameState {FRAME_MORE, FRAME_DONE, FRAME_BAD, FRAME_TEXT};
+
+struct FrameRx {
+    unsigned char index;            // next byte of the frame
+    unsigned char text;             // inside a text line
+};
+
+void frameEncode(char *frame, unsigned int value);
+void frameSeal(char *frame);
+int frameValue(const char *frame);
+int frameSequence(const char *frame);
+int frameTilt(const char *frame, unsigned int axis);
+enum FrameState frameRx(struct FrameRx *rx, char *frame, char byte);
+
+#endif
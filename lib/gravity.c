@@ -0,0 +1,51 @@
+/*
+ * gravity.c
+ *
+ * Accelerometer counts to milli-g, see gravity.h.
+ */
+
+#include "gravity.h"
+
+/*
+ * Function: gravityScale
+ * ---------------------
+ * Turns a calibrated gain in counts per 1 g into the Q8 milli-g per count
+ * sensitivity gravityMilli() multiplies by, so the conversion never
+ * divides. The gain must be at least 4.
+ *
+ * returns: milli-g per count in Q8
+ */
+unsigned int gravityScale(int gain)
+{
+    return (1000UL << GRAVITY_Q) / gain;
+}
+
+/*
+ * Function: gravityMilli
+ * ---------------------
+ * Converts the distance of a reading from its calibrated zero point.
+ * The product is kept in a long: a low gain and a large delta pass the
+ * int range, so the result is clamped to +-GRAVITY_MAX.
+ *
+ * returns: signed gravity value in milli-g
+ */
+int gravityMilli(int delta, unsigned int scale)
+{
+    long milli;
+
+    if ((delta > -GRAVITY_DEAD) && (delta < GRAVITY_DEAD))
+    {
+        return 0;
+    }
+
+    milli = ((long) delta * scale) >> GRAVITY_Q;
+    if (milli > GRAVITY_MAX)
+    {
+        return GRAVITY_MAX;
+    }
+    if (milli < -GRAVITY_MAX)
+    {
+        return -GRAVITY_MAX;
+    }
+    return (int) milli;
+}
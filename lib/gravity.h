@@ -0,0 +1,19 @@
+/*
+ * gravity.h
+ *
+ * Conversion of a calibrated accelerometer reading into signed milli-g
+ * with one multiply by a Q8 sensitivity, shared by the accelerometer
+ * display and the level sensor's UART diagnostics.
+ */
+
+#ifndef LIB_GRAVITY_H
+#define LIB_GRAVITY_H
+
+#define GRAVITY_Q       8           // fraction bits of the milli-g per count sensitivity
+#define GRAVITY_MAX     9999        // milli-g, largest value four places show
+#define GRAVITY_DEAD    4           // counts either side of the offset that read 0
+
+unsigned int gravityScale(int gain);
+int gravityMilli(int delta, unsigned int scale);
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * link.c
+ *
+ * Board link over USCI_A0, see link.h. uartInit() and the pin setup are
+ * left to the caller.
+ */
+
+#include <msp430.h>
+#include "link.h"
+#include "uart.h"
+
+static char Frames[2][FRAME_SIZE];  // handed between main loop and UART ISRs by pointer
+char *Digits = Frames[0];
+char *LinkFrame = Frames[1];
+static unsigned int TxIndex;
+static unsigned char TxSeq;         // sequence of the next frame sent
+static struct FrameRx Rx;
+
+unsigned int LinkStats[LINK_METRICS];
+volatile unsigned int LinkEpoch;
+static const char *const LinkNames[LINK_METRICS] = { "frames", "dropped", "malformed", "order", "interval_ms" };
+static unsigned char LinkSeq;       // sequence expected next
+static unsigned long LinkLast;      // time of the last frame
+static unsigned long LinkTicks;     // averaged ticks between frames
+
+/*
+ * Function: linkSend
+ * ---------------------
+ * Stamps the next sequence number and the check, hands Digits to the
+ * TX ISR by swapping pointers and begins transmission. A frame still
+ * being sent is not interrupted, the new one is dropped instead.
+ */
+void linkSend(void)
+{
+    char *sent;
+
+    if (IE2 & UCA0TXIE)
+    {
+        return;                             // TX ISR still owns LinkFrame
+    }
+    Digits[FRAME_SEQ] = SEQ_BASE + (TxSeq & (SEQ_COUNT - 1));
+    frameSeal(Digits);
+    TxSeq++;
+    sent = LinkFrame;
+    LinkFrame = Digits;
+    Digits = sent;
+    TxIndex = 0;
+    IE2 |= UCA0TXIE;                        // Enable USCI_A0 TX interrupt to begin UART transmission
+}
+
+// UART TX ISR to transmit data
+#pragma vector = USCIAB0TX_VECTOR
+__interrupt void USCI0TX_ISR(void)
+{
+    UCA0TXBUF = LinkFrame[TxIndex];
+    TxIndex++;                              // Transmit next character
+    if (TxIndex >= FRAME_SIZE)
+    {                                       // Check if TX has been completed
+        TxIndex = 0;
+        IE2 &= ~UCA0TXIE;                   // Disable USCI_A0 TX interrupt
+    }
+}
+
+/*
+ * Function: linkRx
+ * ---------------------
+ * Called by the RX ISR with each link byte. A complete frame disables
+ * the RX interrupt until linkReceive() takes it.
+ *
+ * returns: state of the frame, see frameRx()
+ */
+enum FrameState linkRx(char byte)
+{
+    enum FrameState state = frameRx(&Rx, LinkFrame, byte);
+
+    if (state == FRAME_DONE)
+    {
+        IE2 &= ~UCA0RXIE;                   // Disable USCI_A0 RX interrupt until linkReceive() takes the frame
+    }
+    return state;
+}
+
+/*
+ * Function: linkReceive
+ * ---------------------
+ * Takes the frame completed by the RX ISR for display and gives the RX
+ * ISR the frame shown so far to fill next. Called while the RX
+ * interrupt is still disabled, so neither side sees a partial swap,
+ * and enables it again.
+ */
+void linkReceive(void)
+{
+    char *shown;
+
+    shown = Digits;
+    Digits = LinkFrame;
+    LinkFrame = shown;
+    IE2 |= UCA0RXIE;                        // Enable USCI_A0 RX interrupt
+}
+
+/*
+ * Function: linkTime
+ * ---------------------
+ * Extends TA0R with the overflows counted in LinkEpoch, so frame
+ * intervals longer than the 16-bit timer period (524ms at SMCLK/8) are
+ * measured. Timer0_A must run continuously with TAIE set. An overflow
+ * still pending, or counted while reading, is accounted for.
+ *
+ * returns: Timer0_A ticks since it started
+ */
+unsigned long linkTime(void)
+{
+    unsigned int epoch, ticks;
+
+    do
+    {
+        epoch = LinkEpoch;
+        ticks = TA0R;
+    } while (epoch != LinkEpoch);           // overflow ISR ran in between
+    if ((TA0CTL & TAIFG) && (ticks < 0x8000))
+    {
+        epoch++;                            // wrapped but overflow ISR not run yet
+    }
+    return ((unsigned long) epoch << 16) | ticks;
+}
+
+/*
+ * Function: linkFrame
+ * ---------------------
+ * Checks the sequence of a received frame against the one expected and
+ * updates the drop, order and inter-arrival statistics, now is the
+ * arrival time from linkTime(). The first frame only sets
+ * the expected sequence. Gaps of up to half the sequence range count as
+ * dropped frames, anything else as out of order.
+ */
+void linkFrame(char seq, unsigned long now)
+{
+    unsigned char gap;
+
+    if ((seq < SEQ_BASE) || (seq >= SEQ_BASE + SEQ_COUNT))
+    {
+        LinkStats[LINK_MALFORMED]++;
+        return;
+    }
+
+    gap = (seq - SEQ_BASE - LinkSeq) & (SEQ_COUNT - 1);
+    if (LinkStats[LINK_FRAMES] > 0)
+    {
+        if (gap < SEQ_COUNT / 2)
+        {
+            LinkStats[LINK_DROPPED] += gap;
+        }
+        else
+        {
+            LinkStats[LINK_ORDER]++;
+        }
+        if (LinkStats[LINK_FRAMES] == 1)
+        {
+            LinkTicks = now - LinkLast;
+        }
+        else
+        {
+            LinkTicks += ((now - LinkLast) >> LINK_AVG_SHIFT) - (LinkTicks >> LINK_AVG_SHIFT);
+        }
+        LinkStats[LINK_INTERVAL] = LinkTicks / LINK_TICKS_MS;
+    }
+    LinkLast = now;
+    LinkSeq = (seq - SEQ_BASE + 1) & (SEQ_COUNT - 1);
+    LinkStats[LINK_FRAMES]++;
+}
+
+/*
+ * Function: linkDump
+ * ---------------------
+ * Writes every link statistic over the UART as one '!' ';' text line.
+ */
+void linkDump(void)
+{
+    unsigned int i;
+
+    uartPutc(FRAME_TEXT_START);
+    for (i = 0; i < LINK_METRICS; i++)
+    {
+        uartPuts(LinkNames[i]);
+        uartPutc('=');
+        uartPutNum(LinkStats[i]);
+        uartPutc((i < LINK_METRICS - 1) ? ' ' : '\r');
+    }
+    uartPutc('\n');
+    uartPutc(FRAME_TEXT_END);
+}
@@ -0,0 +1,38 @@
+/*
+ * link.h
+ *
+ * Board link over USCI_A0: the frame pair handed between the main loop
+ * and the UART ISRs by pointer, interrupt driven sending on the sensor
+ * MCU, frame reception and link statistics on the display MCU.
+ */
+
+#ifndef LIB_LINK_H
+#define LIB_LINK_H
+
+#include "frame.h"
+
+#define LINK_AVG_SHIFT  3           // inter-arrival average over about 8 frames
+#define LINK_TICKS_MS   125         // Timer0_A ticks per ms at SMCLK/8
+
+enum LinkMetrics {
+    LINK_FRAMES,                    // frames received with a valid sequence
+    LINK_DROPPED,                   // frames missing from the sequence
+    LINK_MALFORMED,                 // wrong length, overrun, failed check or bad sequence character
+    LINK_ORDER,                     // frames repeated or older than the last one
+    LINK_INTERVAL,                  // average ms between frames
+    LINK_METRICS
+};
+
+extern char *Digits;                // owned by the main loop
+extern char *LinkFrame;             // owned by the TX ISR (sensor) or RX ISR (display)
+extern unsigned int LinkStats[LINK_METRICS];
+extern volatile unsigned int LinkEpoch;     // Timer0_A overflows, counted by the app's TAIFG interrupt
+
+void linkSend(void);
+enum FrameState linkRx(char byte);
+void linkReceive(void);
+unsigned long linkTime(void);
+void linkFrame(char seq, unsigned long now);
+void linkDump(void);
+
+#endif
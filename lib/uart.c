@@ -0,0 +1,78 @@
+/*
+ * uart.c
+ *
+ * USCI_A0 setup for the 9600 baud board link and polled output used for
+ * command answers and diagnostic dumps.
+ */
+
+#include <msp430.h>
+#include "uart.h"
+
+/*
+ * Function: uartInit
+ * ---------------------
+ * Sets USCI_A0 to 9600 baud from the 1MHz SMCLK. The caller selects the
+ * RXD/TXD pins and enables the interrupts it needs.
+ */
+void uartInit(void)
+{
+    UCA0CTL1 = UCSSEL_2 + UCSWRST;          // SMCLK, held in reset
+    UCA0BR0 = 104;                          // 1MHz 9600
+    UCA0BR1 = 0;                            // 1MHz 9600
+    UCA0MCTL = UCBRS0;                      // Modulation UCBRSx = 1
+    UCA0CTL1 = UCSSEL_2;                    // **Initialize USCI state machine**
+}
+
+/*
+ * Function: uartPutc
+ * ---------------------
+ * Sends one character by polling. Wait for any interrupt driven frame to
+ * finish before using it.
+ */
+void uartPutc(char c)
+{
+    while (!(IFG2 & UCA0TXIFG));
+    UCA0TXBUF = c;
+#ifdef SIM_UART_TX
+    SIM_UART_TX(c);                         // the host register stub cannot see the write
+#endif
+}
+
+void uartPuts(const char *str)
+{
+    while (*str)
+    {
+        uartPutc(*str++);
+    }
+}
+
+void uartPutNum(unsigned long val)
+{
+    char buf[10];
+    unsigned int i = 0;
+
+    do
+    {
+        buf[i++] = (val % 10) + 48;
+        val /= 10;
+    } while (val != 0);
+
+    while (i > 0)
+    {
+        uartPutc(buf[--i]);
+    }
+}
+
+/*
+ * Function: uartPutHex
+ * ---------------------
+ * Sends a byte as two upper case hex digits, for binary dumps that must
+ * travel as text.
+ */
+void uartPutHex(unsigned char val)
+{
+    static const char Hex[] = "0123456789ABCDEF";
+
+    uartPutc(Hex[val >> 4]);
+    uartPutc(Hex[val & 0x0F]);
+}
@@ -0,0 +1,17 @@
+/*
+ * uart.h
+ *
+ * USCI_A0 setup for the 9600 baud board link and polled output used for
+ * command answers and diagnostic dumps.
+ */
+
+#ifndef LIB_UART_H
+#define LIB_UART_H
+
+void uartInit(void);
+void uartPutc(char c);
+void uartPuts(const char *str);
+void uartPutNum(unsigned long val);
+void uartPutHex(unsigned char val);
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * watchdog.c
+ *
+ * Watchdog supervision and the reset log, see watchdog.h.
+ */
+
+#include <msp430.h>
+#include "flash.h"
+#include "watchdog.h"
+
+#define RST_MAGIC 0x5E7D
+#define RST_SEG_D ((const struct ResetLog *) INFO_SEG(INFO_D))
+#define RST_WORDS (sizeof(struct ResetLog) / sizeof(unsigned int))
+
+#ifdef __GNUC__
+unsigned int Heartbeat __attribute__((noinit));    // msp430-gcc spelling of NOINIT
+#else
+#pragma NOINIT(Heartbeat)
+unsigned int Heartbeat;
+#endif
+unsigned int WdtResets = 0;
+
+/*
+ * Function: watchdogStart
+ * ---------------------
+ * Records the cause of the last reset and starts the watchdog from the
+ * VLO. Called once the clocks are set, with the watchdog held since
+ * reset; the main loop has to call supervise() from then on.
+ */
+void watchdogStart(void)
+{
+    BCSCTL3 = LFXT1S_2;                     // ACLK from the VLO for the watchdog
+    resetRecord();
+    WDTCTL = WDT_FEED;                      // supervised from here on
+}
+
+/*
+ * Function: resetRecord
+ * ---------------------
+ * Counts a watchdog reset in the log kept in information memory segment
+ * D, together with the tasks that had checked in before it. Other resets
+ * leave the flash untouched so power cycles do not wear it.
+ */
+void resetRecord(void)
+{
+    struct ResetLog log = { RST_MAGIC, 0, 0, 0 };
+
+    if ((RST_SEG_D->magic == RST_MAGIC) && (RST_SEG_D->checksum == flashChecksum(RST_SEG_D, RST_WORDS - 1)))
+    {
+        log = *RST_SEG_D;
+    }
+
+    if (IFG1 & WDTIFG)
+    {
+        IFG1 &= ~WDTIFG;
+        log.wdtResets++;
+        log.lastBeats = Heartbeat;
+        log.checksum = flashChecksum(&log, RST_WORDS - 1);
+        flashWrite((unsigned int *) RST_SEG_D, &log, RST_WORDS);
+    }
+    WdtResets = log.wdtResets;
+    Heartbeat = 0;
+}
+
+/*
+ * Function: supervise
+ * ---------------------
+ * Feeds the watchdog once every task in the passed mask has checked in
+ * since the last feed. A task that stops checking in lets it expire.
+ */
+void supervise(unsigned int tasks)
+{
+    if ((Heartbeat & tasks) == tasks)
+    {
+        WDTCTL = WDT_FEED;
+        Heartbeat = 0;
+    }
+}
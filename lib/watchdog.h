@@ -0,0 +1,32 @@
+/*
+ * watchdog.h
+ *
+ * Watchdog supervision shared by the apps. Every task of a main loop
+ * checks in with HEARTBEAT() and supervise() feeds the watchdog only
+ * once all of them have, so a task that hangs or stops running lets it
+ * expire. A watchdog reset is counted in a log kept in information
+ * memory segment D together with the tasks that had checked in.
+ */
+
+#ifndef LIB_WATCHDOG_H
+#define LIB_WATCHDOG_H
+
+#define WDT_FEED WDT_ARST_1000      // ACLK/32768, about 2.7s from the VLO
+#define HEARTBEAT(task) Heartbeat |= (task)
+
+struct ResetLog
+{
+    unsigned int magic;
+    unsigned int wdtResets;         // watchdog resets since the log was created
+    unsigned int lastBeats;         // tasks that had checked in before the last one
+    unsigned int checksum;
+};
+
+extern unsigned int Heartbeat;      // tasks checked in since the last feed, kept over a reset
+extern unsigned int WdtResets;      // from the reset log
+
+void watchdogStart(void);
+void resetRecord(void);
+void supervise(unsigned int tasks);
+
+#endif
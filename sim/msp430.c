@@ -0,0 +1,217 @@
+/*
+ * msp430.c
+ *
+ * Register storage and intrinsics behind sim/msp430.h. Registers start
+ * out as after a power up with the USCI transmitter idle, so polled
+ * output does not block.
+ */
+
+#include <string.h>
+#include <msp430.h>
+
+#define SFR_8BIT_DEF(name)  volatile unsigned char name
+#define SFR_16BIT_DEF(name) volatile unsigned int name
+
+SFR_8BIT_DEF(P1IN);  SFR_8BIT_DEF(P1OUT); SFR_8BIT_DEF(P1DIR); SFR_8BIT_DEF(P1IFG);
+SFR_8BIT_DEF(P1IES); SFR_8BIT_DEF(P1IE);  SFR_8BIT_DEF(P1SEL); SFR_8BIT_DEF(P1SEL2);
+SFR_8BIT_DEF(P1REN);
+SFR_8BIT_DEF(P2IN);  SFR_8BIT_DEF(P2OUT); SFR_8BIT_DEF(P2DIR); SFR_8BIT_DEF(P2IFG);
+SFR_8BIT_DEF(P2IES); SFR_8BIT_DEF(P2IE);  SFR_8BIT_DEF(P2SEL); SFR_8BIT_DEF(P2SEL2);
+SFR_8BIT_DEF(P2REN);
+
+SFR_8BIT_DEF(IE1); SFR_8BIT_DEF(IFG1); SFR_8BIT_DEF(IE2);
+volatile unsigned char IFG2 = UCA0TXIFG;
+SFR_8BIT_DEF(DCOCTL); SFR_8BIT_DEF(BCSCTL1); SFR_8BIT_DEF(BCSCTL2); SFR_8BIT_DEF(BCSCTL3);
+const volatile unsigned char CALBC1_1MHZ = 0x86, CALDCO_1MHZ = 0xB5;
+const volatile unsigned char CALBC1_8MHZ = 0x8D, CALDCO_8MHZ = 0x92;
+const volatile unsigned char CALBC1_12MHZ = 0x8E, CALDCO_12MHZ = 0x9C;
+const volatile unsigned char CALBC1_16MHZ = 0x8F, CALDCO_16MHZ = 0x97;
+
+SFR_16BIT_DEF(WDTCTL);
+SFR_16BIT_DEF(FCTL1); SFR_16BIT_DEF(FCTL2); SFR_16BIT_DEF(FCTL3);
+unsigned int SimInfo[SIM_INFO_SEGMENTS][SIM_INFO_WORDS];    // zero until simFlashInit()
+unsigned long SimFlashErases[SIM_INFO_SEGMENTS];            // wear per segment
+
+SFR_16BIT_DEF(ADC10CTL0); SFR_16BIT_DEF(ADC10CTL1); SFR_16BIT_DEF(ADC10SA);
+SFR_8BIT_DEF(ADC10AE0); SFR_8BIT_DEF(ADC10DTC0); SFR_8BIT_DEF(ADC10DTC1);
+unsigned int SimAdc10Mem;               // result when no hook is set
+unsigned int (*SimAdcHook)(void);       // called once per result read
+
+SFR_16BIT_DEF(TA0CTL); SFR_16BIT_DEF(TA0R); SFR_16BIT_DEF(TA0IV);
+SFR_16BIT_DEF(TA0CCTL0); SFR_16BIT_DEF(TA0CCTL1); SFR_16BIT_DEF(TA0CCTL2);
+SFR_16BIT_DEF(TA0CCR0); SFR_16BIT_DEF(TA0CCR1); SFR_16BIT_DEF(TA0CCR2);
+SFR_16BIT_DEF(TA1CTL); SFR_16BIT_DEF(TA1IV);
+SFR_16BIT_DEF(TA1CCTL0); SFR_16BIT_DEF(TA1CCTL1); SFR_16BIT_DEF(TA1CCTL2);
+SFR_16BIT_DEF(TA1CCR0); SFR_16BIT_DEF(TA1CCR1); SFR_16BIT_DEF(TA1CCR2);
+unsigned int SimTa1r;                   // count when no hook is set
+unsigned int (*SimTimer1Hook)(void);    // called once per count read
+
+SFR_8BIT_DEF(UCA0CTL0); SFR_8BIT_DEF(UCA0CTL1); SFR_8BIT_DEF(UCA0BR0); SFR_8BIT_DEF(UCA0BR1);
+SFR_8BIT_DEF(UCA0MCTL); SFR_8BIT_DEF(UCA0STAT); SFR_8BIT_DEF(UCA0RXBUF); SFR_8BIT_DEF(UCA0TXBUF);
+void (*SimTxHook)(char);                // called with every polled character
+
+void (*SimDelayHook)(unsigned long);  // called with every busy wait
+
+static unsigned int StatusReg;
+
+/*
+ * Function: simAdcRead
+ * ---------------------
+ * Stands in for reading ADC10MEM. Tests feed a fixed result through
+ * SimAdc10Mem or a sequence of results, noise included, through
+ * SimAdcHook.
+ *
+ * returns: the 10-bit conversion result
+ */
+unsigned int simAdcRead(void)
+{
+    if (SimAdcHook)
+    {
+        return SimAdcHook() & 0x3FF;
+    }
+    return SimAdc10Mem & 0x3FF;
+}
+
+/*
+ * Function: simTimer1Read
+ * ---------------------
+ * Stands in for reading TA1R. Tests hold the count in SimTa1r or let
+ * SimTimer1Hook move it on between reads, such as across an ISR body.
+ *
+ * returns: the 16-bit Timer1_A count
+ */
+unsigned int simTimer1Read(void)
+{
+    if (SimTimer1Hook)
+    {
+        return SimTimer1Hook() & 0xFFFF;
+    }
+    return SimTa1r & 0xFFFF;
+}
+
+/*
+ * Function: simUartTx
+ * ---------------------
+ * Called by uartPutc() after writing UCA0TXBUF, so a test can read the
+ * polled output. Frames sent by the TX ISR do not pass here.
+ */
+void simUartTx(char c)
+{
+    if (SimTxHook)
+    {
+        SimTxHook(c);
+    }
+}
+
+/*
+ * Function: simFlashInit
+ * ---------------------
+ * Leaves every information memory segment erased, as a new device, and
+ * clears the erase counts.
+ */
+void simFlashInit(void)
+{
+    memset(SimInfo, 0xFF, sizeof(SimInfo));
+    memset(SimFlashErases, 0, sizeof(SimFlashErases));
+}
+
+/*
+ * Function: simFlashErase
+ * ---------------------
+ * Called by flashWrite() after the dummy write of a segment erase. Sets
+ * the segment holding addr back to all ones and counts the erase. An
+ * address outside information memory, such as a test buffer, is left as
+ * it is.
+ */
+void simFlashErase(volatile void *addr)
+{
+    const volatile unsigned int *word = (const volatile unsigned int *) addr;
+    unsigned int seg;
+
+    for (seg = 0; seg < SIM_INFO_SEGMENTS; seg++)
+    {
+        if ((word >= SimInfo[seg]) && (word < SimInfo[seg] + SIM_INFO_WORDS))
+        {
+            memset(SimInfo[seg], 0xFF, sizeof(SimInfo[seg]));
+            SimFlashErases[seg]++;
+        }
+    }
+}
+
+/*
+ * Function: simFlashTear
+ * ---------------------
+ * Leaves only the first words of a segment written and the rest erased,
+ * as a power loss part way through flashWrite() would.
+ */
+void simFlashTear(unsigned int seg, unsigned int words)
+{
+    for (; words < SIM_INFO_WORDS; words++)
+    {
+        SimInfo[seg][words] = ~0u;
+    }
+}
+
+/*
+ * Function: simFlashFlip
+ * ---------------------
+ * Flips one bit of a segment, as a worn or disturbed flash cell would.
+ */
+void simFlashFlip(unsigned int seg, unsigned int word, unsigned int bit)
+{
+    SimInfo[seg][word] ^= 1u << bit;
+}
+
+/*
+ * Function: __delay_cycles
+ * ---------------------
+ * Returns at once unless SimDelayHook is set. A harness that keeps
+ * time hooks it to advance its clock by the MCLK cycles waited and to
+ * look at the ports while they hold still.
+ */
+void __delay_cycles(unsigned long cycles)
+{
+    if (SimDelayHook)
+    {
+        SimDelayHook(cycles);
+    }
+}
+
+void __bis_SR_register(unsigned int bits)
+{
+    StatusReg |= bits & GIE;            // low power bits would sleep forever
+}
+
+void __bic_SR_register(unsigned int bits)
+{
+    StatusReg &= ~bits;
+}
+
+void __bis_SR_register_on_exit(unsigned int bits)
+{
+    (void) bits;
+}
+
+void __bic_SR_register_on_exit(unsigned int bits)
+{
+    (void) bits;
+}
+
+unsigned int __get_SR_register(void)
+{
+    return StatusReg;
+}
+
+void __enable_interrupt(void)
+{
+    StatusReg |= GIE;
+}
+
+void __disable_interrupt(void)
+{
+    StatusReg &= ~GIE;
+}
+
+void __no_operation(void)
+{
+}
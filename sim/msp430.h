@@ -0,0 +1,221 @@
+/*
+ * msp430.h
+ *
+ * Host stand-in for the MSP430G2553 device header. Every register is a
+ * plain variable defined in sim/msp430.c, so firmware sources compile
+ * with the host compiler for the tests and tools under make host. The
+ * bit names carry the device values; the intrinsics do nothing.
+ *
+ * A host int is 32 bits where the device has 16, code under test that
+ * relies on 16-bit wrap has to be checked with explicit casts.
+ */
+
+#ifndef SIM_MSP430_H
+#define SIM_MSP430_H
+
+#define SFR_8BIT(name)  extern volatile unsigned char name
+#define SFR_16BIT(name) extern volatile unsigned int name
+
+#define BIT0 0x0001
+#define BIT1 0x0002
+#define BIT2 0x0004
+#define BIT3 0x0008
+#define BIT4 0x0010
+#define BIT5 0x0020
+#define BIT6 0x0040
+#define BIT7 0x0080
+
+/* ports */
+SFR_8BIT(P1IN);  SFR_8BIT(P1OUT); SFR_8BIT(P1DIR); SFR_8BIT(P1IFG);
+SFR_8BIT(P1IES); SFR_8BIT(P1IE);  SFR_8BIT(P1SEL); SFR_8BIT(P1SEL2);
+SFR_8BIT(P1REN);
+SFR_8BIT(P2IN);  SFR_8BIT(P2OUT); SFR_8BIT(P2DIR); SFR_8BIT(P2IFG);
+SFR_8BIT(P2IES); SFR_8BIT(P2IE);  SFR_8BIT(P2SEL); SFR_8BIT(P2SEL2);
+SFR_8BIT(P2REN);
+
+/* special function, clock and calibration */
+SFR_8BIT(IE1); SFR_8BIT(IFG1); SFR_8BIT(IE2); SFR_8BIT(IFG2);
+SFR_8BIT(DCOCTL); SFR_8BIT(BCSCTL1); SFR_8BIT(BCSCTL2); SFR_8BIT(BCSCTL3);
+extern const volatile unsigned char CALBC1_1MHZ, CALDCO_1MHZ;
+extern const volatile unsigned char CALBC1_8MHZ, CALDCO_8MHZ;
+extern const volatile unsigned char CALBC1_12MHZ, CALDCO_12MHZ;
+extern const volatile unsigned char CALBC1_16MHZ, CALDCO_16MHZ;
+
+#define DIVS_0 0x00
+#define DIVS_3 0x06
+#define DIVM_0 0x00
+#define DIVM_3 0x30
+#define LFXT1S_2 0x20
+#define OFIFG 0x02
+
+/* watchdog */
+SFR_16BIT(WDTCTL);
+#define WDTPW 0x5A00
+#define WDTHOLD 0x0080
+#define WDTCNTCL 0x0008
+#define WDTSSEL 0x0004
+#define WDTIFG 0x01
+#define WDTIE 0x01
+#define WDT_ARST_1000 (WDTPW + WDTCNTCL + WDTSSEL)
+
+/* flash controller */
+SFR_16BIT(FCTL1); SFR_16BIT(FCTL2); SFR_16BIT(FCTL3);
+#define FWKEY 0xA500
+#define ERASE 0x0002
+#define WRT 0x0040
+#define FN1 0x0002
+#define FSSEL_2 0x0080
+#define LOCK 0x0010
+
+/* information memory, INFO_SEG() of lib/flash.h in host memory. A segment
+ * holds as many host words as the device has 16-bit words, flashWrite()
+ * erases through SIM_FLASH_ERASE and the tests inject corruption */
+#define SIM_INFO_SEGMENTS 4
+#define SIM_INFO_WORDS 32
+extern unsigned int SimInfo[SIM_INFO_SEGMENTS][SIM_INFO_WORDS];
+extern unsigned long SimFlashErases[SIM_INFO_SEGMENTS];
+#define INFO_SEG(n) ((void *) SimInfo[n])
+#define SIM_FLASH_ERASE(addr) simFlashErase(addr)
+void simFlashInit(void);
+void simFlashErase(volatile void *addr);
+void simFlashTear(unsigned int seg, unsigned int words);
+void simFlashFlip(unsigned int seg, unsigned int word, unsigned int bit);
+
+/* ADC10, a conversion result comes from simAdcRead */
+SFR_16BIT(ADC10CTL0); SFR_16BIT(ADC10CTL1); SFR_16BIT(ADC10SA);
+SFR_8BIT(ADC10AE0); SFR_8BIT(ADC10DTC0); SFR_8BIT(ADC10DTC1);
+extern unsigned int SimAdc10Mem;
+extern unsigned int (*SimAdcHook)(void);
+unsigned int simAdcRead(void);
+#define ADC10MEM simAdcRead()
+
+#define ADC10SC 0x0001
+#define ENC 0x0002
+#define ADC10IFG 0x0004
+#define ADC10IE 0x0008
+#define ADC10ON 0x0010
+#define REFON 0x0020
+#define MSC 0x0080
+#define ADC10SHT_0 (0 * 0x800u)
+#define ADC10SHT_1 (1 * 0x800u)
+#define ADC10SHT_2 (2 * 0x800u)
+#define ADC10SHT_3 (3 * 0x800u)
+#define SREF_0 (0 * 0x2000u)
+#define ADC10BUSY 0x0001
+#define CONSEQ_0 (0 * 2u)
+#define CONSEQ_1 (1 * 2u)
+#define CONSEQ_2 (2 * 2u)
+#define CONSEQ_3 (3 * 2u)
+#define ADC10SSEL_0 (0 * 8u)
+#define ADC10SSEL_3 (3 * 8u)
+#define ADC10DIV_0 (0 * 0x20u)
+#define ADC10DIV_3 (3 * 0x20u)
+#define SHS_0 (0 * 0x400u)
+#define INCH_0 (0 * 0x1000u)
+#define INCH_1 (1 * 0x1000u)
+#define INCH_2 (2 * 0x1000u)
+#define INCH_3 (3 * 0x1000u)
+#define INCH_4 (4 * 0x1000u)
+#define INCH_5 (5 * 0x1000u)
+#define INCH_6 (6 * 0x1000u)
+#define INCH_7 (7 * 0x1000u)
+
+/* Timer0_A3 and Timer1_A3, a Timer1_A count comes from simTimer1Read */
+SFR_16BIT(TA0CTL); SFR_16BIT(TA0R); SFR_16BIT(TA0IV);
+SFR_16BIT(TA0CCTL0); SFR_16BIT(TA0CCTL1); SFR_16BIT(TA0CCTL2);
+SFR_16BIT(TA0CCR0); SFR_16BIT(TA0CCR1); SFR_16BIT(TA0CCR2);
+SFR_16BIT(TA1CTL); SFR_16BIT(TA1IV);
+SFR_16BIT(TA1CCTL0); SFR_16BIT(TA1CCTL1); SFR_16BIT(TA1CCTL2);
+SFR_16BIT(TA1CCR0); SFR_16BIT(TA1CCR1); SFR_16BIT(TA1CCR2);
+extern unsigned int SimTa1r;
+extern unsigned int (*SimTimer1Hook)(void);
+unsigned int simTimer1Read(void);
+#define TA1R simTimer1Read()
+#define TACTL TA0CTL
+#define TAR TA0R
+#define TAIV TA0IV
+#define TACCTL0 TA0CCTL0
+#define TACCTL1 TA0CCTL1
+#define TACCTL2 TA0CCTL2
+#define TACCR0 TA0CCR0
+#define TACCR1 TA0CCR1
+#define TACCR2 TA0CCR2
+
+#define TASSEL_1 0x0100
+#define TASSEL_2 0x0200
+#define ID_0 0x0000
+#define ID_3 0x00C0
+#define MC_0 0x0000
+#define MC_1 0x0010
+#define MC_2 0x0020
+#define TACLR 0x0004
+#define TAIE 0x0002
+#define TAIFG 0x0001
+#define CM_1 0x4000
+#define CM_2 0x8000
+#define CM_3 0xC000
+#define CCIS_0 0x0000
+#define CCIS_1 0x1000
+#define SCS 0x0800
+#define SCCI 0x0400
+#define CAP 0x0100
+#define OUTMOD_7 0x00E0
+#define CCIE 0x0010
+#define CCI 0x0008
+#define OUT 0x0004
+#define COV 0x0002
+#define CCIFG 0x0001
+#define TA0IV_NONE 0
+#define TA0IV_TACCR1 2
+#define TA0IV_TACCR2 4
+#define TA0IV_TAIFG 10
+#define TA1IV_NONE 0
+#define TA1IV_TACCR1 2
+#define TA1IV_TACCR2 4
+#define TA1IV_TAIFG 10
+
+/* USCI_A0, polled output from uartPutc() is passed on through SIM_UART_TX */
+SFR_8BIT(UCA0CTL0); SFR_8BIT(UCA0CTL1); SFR_8BIT(UCA0BR0); SFR_8BIT(UCA0BR1);
+SFR_8BIT(UCA0MCTL); SFR_8BIT(UCA0STAT); SFR_8BIT(UCA0RXBUF); SFR_8BIT(UCA0TXBUF);
+extern void (*SimTxHook)(char c);
+#define SIM_UART_TX(c) simUartTx(c)
+void simUartTx(char c);
+#define UCSSEL_2 0x80
+#define UCSWRST 0x01
+#define UCBRS0 0x02
+#define UCA0RXIE 0x01
+#define UCA0TXIE 0x02
+#define UCA0RXIFG 0x01
+#define UCA0TXIFG 0x02
+
+/* status register */
+#define GIE 0x0008
+#define CPUOFF 0x0010
+#define OSCOFF 0x0020
+#define SCG0 0x0040
+#define SCG1 0x0080
+#define LPM0_bits (CPUOFF)
+#define LPM1_bits (SCG0 + CPUOFF)
+#define LPM3_bits (SCG1 + SCG0 + CPUOFF)
+#define LPM4_bits (SCG1 + SCG0 + OSCOFF + CPUOFF)
+#define LPM0 __bis_SR_register(LPM0_bits)
+#define LPM0_EXIT __bic_SR_register_on_exit(LPM0_bits)
+#define LPM3_EXIT __bic_SR_register_on_exit(LPM3_bits)
+
+/* interrupt handlers are plain functions, #pragma vector is ignored */
+#define __interrupt
+
+extern void (*SimDelayHook)(unsigned long cycles);
+void __delay_cycles(unsigned long cycles);
+void __bis_SR_register(unsigned int bits);
+void __bic_SR_register(unsigned int bits);
+void __bis_SR_register_on_exit(unsigned int bits);
+void __bic_SR_register_on_exit(unsigned int bits);
+unsigned int __get_SR_register(void);
+void __enable_interrupt(void);
+void __disable_interrupt(void);
+void __no_operation(void);
+#define _enable_interrupt __enable_interrupt
+#define _disable_interrupt __disable_interrupt
+
+#endif
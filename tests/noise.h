@@ -0,0 +1,37 @@
+/*
+ * noise.h
+ *
+ * Noisy potentiometer for the ADC hysteresis tests: SimAdcHook returns
+ * the 10-bit conversion of NoiseLevel plus roughly normal noise of
+ * NoiseSigma counts from a fixed seed, so every run sees the same
+ * samples.
+ */
+
+#ifndef TESTS_NOISE_H
+#define TESTS_NOISE_H
+
+static double NoiseLevel;           // input in 10-bit counts
+static double NoiseSigma = 3.0;     // noise in 10-bit counts
+static unsigned long NoiseSeed = 1;
+
+static double noiseUniform(void)
+{
+    NoiseSeed = NoiseSeed * 1103515245UL + 12345UL;
+    return ((NoiseSeed >> 16) & 0x7FFF) / 32768.0;
+}
+
+static unsigned int noiseSample(void)
+{
+    double sum = 0.0, v;
+    int i;
+
+    for (i=0; i<12; i++){           // Irwin-Hall, sigma 1
+        sum += noiseUniform();
+    }
+    v = NoiseLevel + NoiseSigma * (sum - 6.0) + 0.5;
+    if (v < 0.0){return 0;}
+    if (v > 1023.0){return 1023;}
+    return (unsigned int) v;
+}
+
+#endif
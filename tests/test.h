@@ -0,0 +1,30 @@
+/*
+ * test.h
+ *
+ * Minimal checks for the host tests under make check. A failed CHECK
+ * prints where and keeps going so one run lists every failure; main
+ * returns TEST_RESULT.
+ */
+
+#ifndef TESTS_TEST_H
+#define TESTS_TEST_H
+
+#include <stdio.h>
+
+static unsigned long TestChecks = 0, TestFailures = 0;
+
+#define CHECK(cond, ...) do { \
+        TestChecks++; \
+        if (!(cond)){ \
+            if (TestFailures++ < 20){ \
+                printf("%s:%d: ", __FILE__, __LINE__); \
+                printf(__VA_ARGS__); \
+                printf("\n"); \
+            } \
+        } \
+    } while (0)
+
+#define TEST_RESULT (printf("%s: %lu checks, %lu failed\n", __FILE__, TestChecks, TestFailures), \
+                     TestFailures != 0)
+
+#endif
@@ -0,0 +1,73 @@
+#include <msp430.h>
+#include "test.h"
+#include "lib/board.h"
+
+/***************************************************************************
+ * test_board.c
+ * Host test for lib/board.h
+ *
+ * No pin of a port is claimed by two roles of the same MCU and each port
+ * register image only touches pins of that port's roles.
+ *
+ ***************************************************************************/
+
+struct Role
+{
+    const char *name;
+    unsigned int pins;
+};
+
+#define ROLE(pins) {#pins, pins},
+
+static const struct Role SensorP1[] = { SENSOR_P1_ROLES(ROLE) };
+static const struct Role SensorP2[] = { SENSOR_P2_ROLES(ROLE) };
+static const struct Role DisplayP1[] = { DISPLAY_P1_ROLES(ROLE) };
+static const struct Role DisplayP2[] = { DISPLAY_P2_ROLES(ROLE) };
+
+/*
+ * Function:  checkPort
+ * ----------------------
+ * Checks the roles of one port for empty and shared pins, returns all
+ * the pins they claim.
+ */
+unsigned int checkPort(const char *port, const struct Role *roles, unsigned int n)
+{
+    unsigned int i, j, pins = 0;
+
+    for (i = 0; i < n; i++){
+        CHECK(roles[i].pins != 0 && roles[i].pins <= 0xFF, "%s %s is pins 0x%X", port, roles[i].name, roles[i].pins);
+        for (j = i + 1; j < n; j++)
+            CHECK((roles[i].pins & roles[j].pins) == 0, "%s %s and %s share pins 0x%X", port,
+                  roles[i].name, roles[j].name, roles[i].pins & roles[j].pins);
+        pins |= roles[i].pins;
+    }
+    return pins;
+}
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+#define WITHIN(image, pins) CHECK(((image) & ~(pins)) == 0, #image " touches unassigned pins 0x%X", (image) & ~(pins))
+
+int main(void)
+{
+    unsigned int sensorP1 = checkPort("sensor P1", SensorP1, COUNT(SensorP1));
+    unsigned int sensorP2 = checkPort("sensor P2", SensorP2, COUNT(SensorP2));
+    unsigned int displayP1 = checkPort("display P1", DisplayP1, COUNT(DisplayP1));
+    unsigned int displayP2 = checkPort("display P2", DisplayP2, COUNT(DisplayP2));
+
+    WITHIN(SENSOR_P1SEL, sensorP1);
+    WITHIN(SENSOR_P2DIR, sensorP2);
+    WITHIN(SENSOR_P2SEL, sensorP2);
+    WITHIN(SENSOR_P2REN, sensorP2);
+    WITHIN(SENSOR_P2OUT, sensorP2);
+    WITHIN(SENSOR_P2IES, sensorP2);
+    WITHIN(DISPLAY_P1DIR, displayP1);
+    WITHIN(DISPLAY_P1SEL, displayP1);
+    WITHIN(DISPLAY_P2DIR, displayP2);
+
+    /* both MCUs read the strap and the ADC gets the ambient input */
+    CHECK((sensorP1 & displayP1 & HW_FLAG) == HW_FLAG, "role strap not on both MCUs");
+    CHECK(AMBIENT_INCH == INCH_3 && AMBIENT_P == BIT3, "ambient input 0x%X not on A3", AMBIENT_P);
+    CHECK(displayP2 == 0xFF, "display P2 pins 0x%X, segments and point should use the whole port", displayP2);
+
+    return TEST_RESULT;
+}
@@ -0,0 +1,138 @@
+#include <setjmp.h>
+#include <string.h>
+#include "test.h"
+
+/***************************************************************************
+ * test_boot.c
+ * Host test for the boot time of level_and_distance_sensor.c
+ *
+ * Builds the firmware with LOOP_PROFILE set to 1 and boots the sensor
+ * role through startup() on the 8MHz calibration. Timer1_A counts a
+ * simulated SMCLK that busy waits move on at the MCLK their divider
+ * gives; every wrap sets TAIFG and runs the overflow ISR once TAIE and
+ * GIE allow it. Boot work the stub cannot time is added as a stall
+ * before main first reads the timer. LOOP_BOOT, read when the first
+ * frame is sent, must match the simulated time past the 65ms wrap.
+ *
+ ***************************************************************************/
+
+#define LOOP_PROFILE 1
+#define main fw_main
+#include "level_and_distance_sensor.c"
+#undef main
+
+unsigned long Clock;                // SMCLK ticks, 1us each, since reset
+unsigned long Stall;                // boot work before the first TA1R read
+unsigned int Reads;
+unsigned long FastUs;               // busy waits at the burst clock
+jmp_buf Done;
+
+/*
+ * Function:  overflow
+ * ----------------------
+ * Runs the Timer1_A overflow ISR for a pending TAIFG when it is
+ * enabled, as the device would as soon as TAIE and GIE are both set.
+ */
+void overflow(void)
+{
+    if ((TA1CTL & TAIFG) && (TA1CTL & TAIE) && (__get_SR_register() & GIE)){
+        TA1IV = TA1IV_TAIFG;
+        TIMER1_A1_ISR();
+        TA1CTL &= ~TAIFG;           // cleared by reading TA1IV
+    }
+}
+
+void advance(unsigned long us)
+{
+    unsigned long step;
+
+    overflow();
+    while (us > 0){
+        step = 0x10000 - (Clock & 0xFFFF);
+        if (step > us){step = us;}
+        Clock += step;
+        us -= step;
+        if ((Clock & 0xFFFF) == 0){
+            TA1CTL |= TAIFG;
+            overflow();
+        }
+    }
+}
+
+unsigned int timer1(void)
+{
+    if (Reads++ == 0){
+        advance(Stall);
+    }
+    return Clock & 0xFFFF;
+}
+
+/*
+ * Function:  wait
+ * ----------------------
+ * SimDelayHook, moves the clock on by the busy wait at the MCLK set
+ * in BCSCTL1 and BCSCTL2. The first idle wait ends the boot.
+ */
+void wait(unsigned long cycles)
+{
+    unsigned int mhz = (BCSCTL1 == CALBC1_8MHZ) ? 8 : 1;
+
+    mhz >>= (BCSCTL2 & DIVM_3) >> 4;
+    if (BCSCTL2 == ClockSlow){
+        longjmp(Done, 1);
+    }
+    if (mhz == 8){
+        FastUs += cycles / mhz;
+    }
+    advance(cycles / mhz);
+}
+
+/*
+ * Function:  boot
+ * ----------------------
+ * Boots the sensor role from reset with the given stall.
+ *
+ * returns: LOOP_BOOT after the first frame
+ */
+unsigned int boot(unsigned long stall)
+{
+    Clock = 0;
+    Reads = 0;
+    Stall = stall;
+    FastUs = 0;
+    TA1CTL = 0;
+    TimerEpoch = 0;
+    __disable_interrupt();
+    memset(LoopStats, 0, sizeof(LoopStats));
+    IE2 &= ~UCA0TXIE;
+    if (setjmp(Done) == 0){
+        fw_main();
+    }
+    return LoopStats[LOOP_BOOT];
+}
+
+int main(void)
+{
+    static const unsigned long Stalls[] = {3000, 30000, 65000, 65536, 70000, 200000, 1000000};
+    unsigned int i, shown, expect;
+
+    simFlashInit();
+    SimTimer1Hook = timer1;
+    SimDelayHook = wait;
+    System = DISTANCE;              // triggerSensor() busy waits at the burst clock
+
+    for (i=0; i<sizeof(Stalls)/sizeof(Stalls[0]); i++){
+        shown = boot(Stalls[i]);
+        expect = Clock / 100;
+        CHECK(shown <= expect && shown + 3 >= expect, "boot of %luus shows %u, not %u", Clock, shown, expect);
+        CHECK(TimerEpoch == Clock >> 16, "%lu overflows counted, not %lu", (unsigned long) TimerEpoch, Clock >> 16);
+    }
+    CHECK(BCSCTL1 == CALBC1_8MHZ && DCOCTL == CALDCO_8MHZ, "DCO not on the 8MHz calibration");
+    CHECK(ClockFast == DIVM_0 + DIVS_3 && ClockSlow == DIVM_3 + DIVS_3, "dividers 0x%02X and 0x%02X", ClockFast, ClockSlow);
+    CHECK(FastUs == 10, "trigger pulse of %luus at the burst clock", FastUs);
+
+    shown = boot(10000000UL);
+    CHECK(shown == 0xFFFF, "boot of %lus shows %u", Clock / 1000000UL, shown);
+
+    return TEST_RESULT;
+}
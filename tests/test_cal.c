@@ -0,0 +1,121 @@
+#include <string.h>
+#include "test.h"
+
+/***************************************************************************
+ * test_cal.c
+ * Host test for calLoad() and calSave() of level_and_distance_sensor.c
+ *
+ * Runs the calibration store on the information memory of the register
+ * stub. calLoad() must keep the defaults on an erased device, take the
+ * only valid copy, the newer of two, and fall back to the older one
+ * when the newer has a bad magic, a flipped bit or was torn part way
+ * through its write. calSave() must alternate between segments B and C
+ * so both wear evenly.
+ *
+ ***************************************************************************/
+
+#define main fw_main
+#include "level_and_distance_sensor.c"
+#undef main
+
+#define SAVES   100
+
+struct Calibration Defaults;
+
+/*
+ * Function:  boot
+ * ----------------------
+ * Starts over from the compiled in calibration and loads it from flash
+ * as startup does.
+ */
+void boot(void)
+{
+    Cal = Defaults;
+    CalSegment = CAL_SEG_C;
+    calLoad();
+}
+
+/*
+ * Function:  store
+ * ----------------------
+ * Saves a calibration whose X offset tells the copies apart.
+ */
+void store(int offset)
+{
+    Cal.offset[AXIS_X] = offset;
+    calSave();
+}
+
+int main(void)
+{
+    unsigned int i, words;
+    const struct Calibration *older;
+
+    Defaults = Cal;
+
+    simFlashInit();
+    boot();
+    CHECK(memcmp(&Cal, &Defaults, sizeof(Cal)) == 0, "erased flash changed the defaults");
+    CHECK(CalSegment == CAL_SEG_C, "erased flash moved the active segment");
+
+    /* first save goes to B, the segment not holding the default copy */
+    store(400);
+    CHECK(CalSegment == CAL_SEG_B && SimFlashErases[INFO_B] == 1 && SimFlashErases[INFO_C] == 0,
+          "first save erased B %lu and C %lu times", SimFlashErases[INFO_B], SimFlashErases[INFO_C]);
+    boot();
+    CHECK(Cal.offset[AXIS_X] == 400 && CalSegment == CAL_SEG_B, "only copy in B loads offset %d", Cal.offset[AXIS_X]);
+
+    /* second save goes to C and is newer */
+    store(401);
+    CHECK(CalSegment == CAL_SEG_C, "second save not in C");
+    boot();
+    CHECK(Cal.offset[AXIS_X] == 401 && CalSegment == CAL_SEG_C, "newer copy in C loads offset %d", Cal.offset[AXIS_X]);
+
+    /* the newer copy broken in each way falls back to the older one */
+    simFlashFlip(INFO_C, 0, 3);
+    boot();
+    CHECK(Cal.offset[AXIS_X] == 400 && CalSegment == CAL_SEG_B, "bad magic in C loads offset %d", Cal.offset[AXIS_X]);
+    simFlashFlip(INFO_C, 0, 3);
+    for (words=0; words<CAL_WORDS; words++){
+        for (i=0; i<16; i++){
+            simFlashFlip(INFO_C, words, i);
+            boot();
+            CHECK(Cal.offset[AXIS_X] == 400, "bit %u of word %u flipped in C loads offset %d", i, words, Cal.offset[AXIS_X]);
+            simFlashFlip(INFO_C, words, i);
+        }
+    }
+    boot();
+    CHECK(Cal.offset[AXIS_X] == 401, "C not valid again after the flips");
+
+    /* a save torn at any word leaves the previous copy active */
+    for (words=0; words<CAL_WORDS; words++){
+        boot();
+        older = CalSegment;
+        store(500 + words);
+        simFlashTear((CalSegment == CAL_SEG_B) ? INFO_B : INFO_C, words);
+        boot();
+        CHECK(CalSegment == older && Cal.offset[AXIS_X] != (int)(500 + words),
+              "save torn after %u words loads offset %d", words, Cal.offset[AXIS_X]);
+    }
+
+    /* neither copy valid keeps the defaults */
+    simFlashTear(INFO_B, 0);
+    simFlashFlip(INFO_C, CAL_WORDS - 1, 0);
+    boot();
+    CHECK(memcmp(&Cal, &Defaults, sizeof(Cal)) == 0, "two broken copies changed the defaults");
+
+    /* saves alternate, so the segments wear evenly */
+    simFlashInit();
+    boot();
+    for (i=0; i<SAVES; i++){
+        older = CalSegment;
+        store(i);
+        CHECK(CalSegment != older, "save %u wrote the active segment", i);
+        boot();
+        CHECK(Cal.offset[AXIS_X] == (int)i && Cal.count == i + 1, "save %u loads offset %d count %u", i, Cal.offset[AXIS_X], Cal.count);
+    }
+    CHECK(SimFlashErases[INFO_B] == SAVES / 2 && SimFlashErases[INFO_C] == SAVES / 2 && SimFlashErases[INFO_D] == 0,
+          "%u saves erased B %lu, C %lu and D %lu times", SAVES, SimFlashErases[INFO_B], SimFlashErases[INFO_C], SimFlashErases[INFO_D]);
+
+    return TEST_RESULT;
+}
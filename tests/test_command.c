@@ -0,0 +1,94 @@
+#include <string.h>
+#include "test.h"
+
+/***************************************************************************
+ * test_command.c
+ * Host test for the command requester of level_and_distance_sensor.c
+ *
+ * Plays the display MCU: a console request is collected by the RX ISR
+ * and sent once per scan frame by commandRequest(). Answers, a
+ * diagnostics line holding control characters and a frame lookalike,
+ * a refusal and a sensor that never answers must each end the way
+ * the requester documents, with frames still received after them.
+ * Brightness requests are applied by the display itself. A sensor dump
+ * holding '#' bytes, however long, must not start a request.
+ *
+ ***************************************************************************/
+
+#define main fw_main
+#include "level_and_distance_sensor.c"
+#undef main
+
+/*
+ * Function:  rx
+ * ----------------------
+ * Runs USCI0RX_ISR() for every byte of str.
+ */
+void rx(const char *str)
+{
+    while (*str){
+        UCA0RXBUF = *str++;
+        USCI0RX_ISR();
+    }
+}
+
+int main(void)
+{
+    unsigned int bright = BrightManual, i;
+
+    rx("#M1;");
+    CHECK(ReqReady == TRUE, "request not collected");
+    commandRequest();
+    CHECK(ReqWait == CMD_REPLY_FRAMES && ReqSentLen == 4, "request of %u bytes, waiting %u", ReqSentLen, ReqWait);
+
+    rx("!mode=1 x=B,1234Da0,;");
+    commandRequest();
+    CHECK(ReplyStatus == 0 && ReqWait == CMD_REPLY_FRAMES - 1, "diagnostics taken as the answer");
+    CHECK(BrightManual == bright && Flag != SAVE, "diagnostics taken as a control character or frame");
+
+    rx("!+M;");
+    commandRequest();
+    CHECK(ReqWait == 0 && ReqShown == CMD_SHOW_FRAMES && strcmp(ReqResult, "donE") == 0, "answer shows %s", ReqResult);
+
+    rx("#Q;");
+    CHECK(BrightManual == bright, "request taken as a control character");
+    commandRequest();
+    rx("!-*;");
+    commandRequest();
+    CHECK(strcmp(ReqResult, "Err") == 0, "refusal shows %s", ReqResult);
+
+    rx("#B3;");
+    commandRequest();
+    CHECK(BrightManual == 3 && ReqWait == 0 && strcmp(ReqResult, "donE") == 0, "level request shows %s", ReqResult);
+    rx("#B208;");
+    commandRequest();
+    CHECK(DigitDuty[1] == 8 && strcmp(ReqResult, "donE") == 0, "duty request shows %s", ReqResult);
+    rx("#B217;");
+    commandRequest();
+    CHECK(DigitDuty[1] == 8 && strcmp(ReqResult, "Err") == 0, "duty out of range shows %s", ReqResult);
+    rx("#B;");
+    commandRequest();
+    CHECK(ReqWait == 0 && strcmp(ReqResult, "Err") == 0, "empty brightness request shows %s", ReqResult);
+
+    rx("!TIMER1_A1 n=#12 h=3 #1 0\r\n");
+    for (i=0; i<300; i++){
+        rx("#");
+    }
+    rx("+#S9;");
+    commandRequest();
+    CHECK(ReqLen == 0 && ReqReady == FALSE && ReqWait == 0,
+          "dump relayed as a request of %u bytes", ReqLen);
+
+    rx("#S5;");
+    commandRequest();
+    for (i=0; i<(CMD_RETRIES + 1) * CMD_REPLY_FRAMES; i++){
+        commandRequest();
+    }
+    CHECK(strcmp(ReqResult, "nonE") == 0 && ReqWait == 0 && ReqTries == CMD_RETRIES,
+          "no answer shows %s after %u retries", ReqResult, ReqTries);
+
+    rx("1234Db0bc,");
+    CHECK(Flag == SAVE, "frame after the requests not received");
+
+    return TEST_RESULT;
+}
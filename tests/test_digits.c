@@ -0,0 +1,42 @@
+#include <string.h>
+#include "test.h"
+#include "lib/digits.h"
+
+/***************************************************************************
+ * test_digits.c
+ * Host test for lib/digits.c
+ *
+ * Splits every value the 4 digit displays can show and checks the places
+ * against printf, the significant place count of splitDigits() and the
+ * lit place count litDigits() finds on the ASCII frame digits the
+ * display MCU receives, so blanking on the display side matches what
+ * the sensor used to send as the key.
+ *
+ ***************************************************************************/
+
+int main(void)
+{
+    unsigned char place[DIGIT_COUNT];
+    char digits[DIGIT_COUNT], text[8];
+    unsigned int value, count, i;
+
+    for (value=0; value<=9999; value++){
+        count = splitDigits(value, place);
+        sprintf(text, "%04u", value);
+        for (i=0; i<DIGIT_COUNT; i++){
+            CHECK(place[i] == text[DIGIT_COUNT-1-i] - '0', "%u place %u is %u", value, i, place[i]);
+            digits[i] = place[i] + '0';
+        }
+        sprintf(text, "%u", value);
+        CHECK(count == strlen(text), "%u splits into %u places", value, count);
+        CHECK(litDigits(digits) == count, "%u lights %u places", value, litDigits(digits));
+    }
+
+    /* above 9999 the lower four places are kept */
+    count = splitDigits(12345, place);
+    CHECK(count == 4 && place[3] == 2 && place[0] == 5, "12345 splits into %u places", count);
+    count = splitDigits(10000, place);
+    CHECK(count == 4 && place[0] == 0 && place[3] == 0, "10000 splits into %u places", count);
+
+    return TEST_RESULT;
+}
@@ -0,0 +1,63 @@
+#include <string.h>
+#include "test.h"
+#include <msp430.h>
+#include "lib/flash.h"
+
+/***************************************************************************
+ * test_flash.c
+ * Host test for lib/flash.c
+ *
+ * Checks that a record plus its flashChecksum() sums to all ones, that
+ * any single bit flip is caught, and that flashWrite() copies the words,
+ * leaves the flash controller locked and restores the interrupt enable.
+ * Written to information memory, the segment is erased once per write
+ * and nothing of the old contents is left past the new words.
+ *
+ ***************************************************************************/
+
+#define WORDS 8
+
+int main(void)
+{
+    unsigned int record[WORDS + 1] = {0xCA1B, 3, 479, 481, 475, 95, 96, 94, 0};
+    unsigned int segment[WORDS + 1];
+    unsigned int sum, i, bit;
+
+    record[WORDS] = flashChecksum(record, WORDS);
+    for (sum=0, i=0; i<=WORDS; i++){sum += record[i];}
+    CHECK(sum == ~0u, "record sums to %#x", sum);
+    CHECK(flashChecksum(record, 0) == ~0u, "empty record checksum %#x", flashChecksum(record, 0));
+
+    for (i=0; i<WORDS; i++){
+        for (bit=0; bit<16; bit++){
+            record[i] ^= 1u << bit;
+            CHECK(flashChecksum(record, WORDS) != record[WORDS], "flip of word %u bit %u not caught", i, bit);
+            record[i] ^= 1u << bit;
+        }
+    }
+
+    memset(segment, 0xFF, sizeof(segment));
+    __enable_interrupt();
+    flashWrite(segment, record, WORDS + 1);
+    CHECK(memcmp(segment, record, sizeof(record)) == 0, "segment differs from record");
+    CHECK(FCTL3 == FWKEY + LOCK, "FCTL3 left at %#x", FCTL3);
+    CHECK(FCTL1 == FWKEY, "FCTL1 left at %#x", FCTL1);
+    CHECK(__get_SR_register() & GIE, "interrupts left disabled");
+
+    __disable_interrupt();
+    flashWrite(segment, record, WORDS + 1);
+    CHECK(!(__get_SR_register() & GIE), "interrupts enabled by the write");
+
+    simFlashInit();
+    memset(SimInfo[INFO_B], 0, sizeof(SimInfo[INFO_B]));
+    flashWrite(INFO_SEG(INFO_B), record, WORDS + 1);
+    flashWrite(INFO_SEG(INFO_B), record, WORDS);
+    CHECK(memcmp(SimInfo[INFO_B], record, WORDS * sizeof(record[0])) == 0, "segment B differs from record");
+    for (i=WORDS; i<SIM_INFO_WORDS; i++){
+        CHECK(SimInfo[INFO_B][i] == ~0u, "word %u of segment B left at %#x after the erase", i, SimInfo[INFO_B][i]);
+    }
+    CHECK(SimFlashErases[INFO_B] == 2 && SimFlashErases[INFO_C] == 0 && SimFlashErases[INFO_D] == 0,
+          "two writes to B erased B %lu, C %lu and D %lu times", SimFlashErases[INFO_B], SimFlashErases[INFO_C], SimFlashErases[INFO_D]);
+
+    return TEST_RESULT;
+}
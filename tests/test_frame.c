@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "lib/frame.h"
+
+/***************************************************************************
+ * test_frame.c
+ * Host test for lib/frame.c
+ *
+ * Encodes every value the display can show and reads it back through
+ * the receive state machine, checks that short, long, split and
+ * corrupted frames are rejected without losing the frame after them,
+ * that command answers and diagnostics lines never read as frames, and
+ * decodes the signed tilts of ANGLE frames.
+ *
+ ***************************************************************************/
+
+/*
+ * Function:  feed
+ * ----------------------
+ * Runs length bytes through frameRx().
+ *
+ * returns: number of complete frames, bad frames added to *bad
+ */
+unsigned int feed(struct FrameRx *rx, char *frame, const char *bytes, unsigned int length, unsigned int *bad)
+{
+    unsigned int done = 0, i;
+
+    for (i=0; i<length; i++){
+        switch (frameRx(rx, frame, bytes[i])){
+        case FRAME_DONE:
+            done++;
+            break;
+        case FRAME_BAD:
+            (*bad)++;
+            break;
+        default:
+            break;
+        }
+    }
+    return done;
+}
+
+int main(void)
+{
+    struct FrameRx rx = {0};
+    char sent[FRAME_SIZE], got[FRAME_SIZE];
+    unsigned int value, bad = 0, done, i, bit;
+    int x, y;
+
+    for (value=0; value<=9999; value++){
+        frameEncode(sent, value);
+        sent[FRAME_MODE] = MODE_DISTANCE;
+        sent[FRAME_SEQ] = SEQ_BASE + (value & (SEQ_COUNT - 1));
+        frameSeal(sent);
+        CHECK(sent[FRAME_END] == FRAME_END_CHAR && sent[FRAME_SIGNS] == SIGN_BASE, "%u frame not ended", value);
+        done = feed(&rx, got, sent, FRAME_SIZE, &bad);
+        CHECK(done == 1 && bad == 0, "%u gives %u frames, %u bad", value, done, bad);
+        CHECK(memcmp(sent, got, FRAME_SIZE) == 0, "%u received differently", value);
+        CHECK(frameValue(got) == (int)value, "%u reads back as %d", value, frameValue(got));
+        CHECK(frameSequence(got) == (int)(value & (SEQ_COUNT - 1)), "%u sequence %d", value, frameSequence(got));
+    }
+
+    got[0] = 'x';
+    CHECK(frameValue(got) == -1, "non digit reads as %d", frameValue(got));
+    got[FRAME_SEQ] = SEQ_BASE + SEQ_COUNT;
+    CHECK(frameSequence(got) == -1, "bad sequence reads as %d", frameSequence(got));
+
+    /* a short frame, an overrun that also ends short and a good frame */
+    bad = 0;
+    done = feed(&rx, got, "12D,", 4, &bad);
+    CHECK(done == 0 && bad == 1, "short frame: %u frames, %u bad", done, bad);
+    bad = 0;
+    done = feed(&rx, got, "1234Da0bbxx,", 12, &bad);
+    CHECK(done == 0 && bad == 2, "overrun: %u frames, %u bad", done, bad);
+    bad = 0;
+    done = feed(&rx, got, "1234Db0bc,", 10, &bad);
+    CHECK(done == 1 && bad == 0 && frameValue(got) == 4321, "frame after overrun: %u frames, %u bad", done, bad);
+
+    /* every single bit error of a frame, the check included */
+    frameEncode(sent, 1234);
+    sent[FRAME_MODE] = MODE_ANGLE;
+    sent[FRAME_SEQ] = SEQ_BASE;
+    frameSeal(sent);
+    for (i=0; i<FRAME_END; i++){
+        for (bit=0; bit<8; bit++){
+            struct FrameRx fresh = {0};
+            char hit[FRAME_SIZE];
+
+            memcpy(hit, sent, FRAME_SIZE);
+            hit[i] ^= 1 << bit;
+            bad = 0;
+            done = feed(&fresh, got, hit, FRAME_SIZE, &bad);
+            CHECK(done == 0, "bit %u of byte %u flipped, frame still taken", bit, i);
+            if (fresh.text == 0){
+                done = feed(&fresh, got, sent, FRAME_SIZE, &bad);
+                CHECK(done == 1 && bad == 1, "bit %u of byte %u flipped: %u frames, %u bad after it", bit, i, done, bad);
+            }
+        }
+    }
+
+    /* text lines, one looking like a frame and one cutting a frame short */
+    bad = 0;
+    done = feed(&rx, got, "!+M;!mode=1 wdt=0,12,;1234Dc0bd,", 32, &bad);
+    CHECK(done == 1 && bad == 0 && frameValue(got) == 4321, "frame after text: %u frames, %u bad", done, bad);
+    bad = 0;
+    done = feed(&rx, got, "123!-*;5678Dd0bm,", 17, &bad);
+    CHECK(done == 1 && bad == 0 && frameValue(got) == 8765, "text inside a frame: %u frames, %u bad", done, bad);
+
+    /* tilt of ANGLE frames, X in d3 d2 and Y in d1 d0 */
+    for (x=-90; x<=90; x++){
+        for (y=-90; y<=90; y+=7){
+            frameEncode(sent, abs(x) * 100 + abs(y));
+            sent[FRAME_MODE] = MODE_ANGLE;
+            sent[FRAME_SIGNS] = SIGN_BASE + ((x < 0) ? SIGN_X : 0) + ((y < 0) ? SIGN_Y : 0);
+            CHECK(frameTilt(sent, SIGN_X) == x && frameTilt(sent, SIGN_Y) == y,
+                  "tilt %d %d reads as %d %d", x, y, frameTilt(sent, SIGN_X), frameTilt(sent, SIGN_Y));
+        }
+    }
+
+    return TEST_RESULT;
+}
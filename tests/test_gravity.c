@@ -0,0 +1,56 @@
+#include <stdlib.h>
+#include "test.h"
+
+/***************************************************************************
+ * test_gravity.c
+ * Host test for adc_accelerometer.c
+ *
+ * Checks the one multiply getGravity() against delta * 1000 / gain for
+ * every calibrated gain from CAL_MIN_GAIN up and every ADC reading, the
+ * +-3 count dead band around the offset and the clamp to +-GRAVITY_MAX
+ * where the product passes the 16-bit int range. display_B() must show
+ * full scale as 9.9 rather than wrapping the rounded tenths.
+ *
+ ***************************************************************************/
+
+#define main fw_main
+#include "adc_accelerometer.c"
+#undef main
+
+#define GRAVITY_TOL     4           // Q8 scale and shift truncation, milli-g
+
+int main(void)
+{
+    int gain, delta, got;
+    long want;
+    unsigned int axis;
+
+    for (axis=0; axis<3; axis++){
+        Cal.offset[axis] = MEDIAN;
+        for (gain=CAL_MIN_GAIN; gain<=512; gain++){
+            Cal.gain[axis] = gain;
+            setGravityScale();
+            for (delta=-MEDIAN; delta<=1023-MEDIAN; delta++){
+                want = (long)delta * 1000 / gain;
+                if (want > GRAVITY_MAX){want = GRAVITY_MAX;}
+                if (want < -GRAVITY_MAX){want = -GRAVITY_MAX;}
+                got = getGravity(MEDIAN + delta, axis);
+                if ((delta > -4) && (delta < 4)){
+                    CHECK(got == 0, "axis %u gain %d delta %d gives %d in the dead band", axis, gain, delta, got);
+                }
+                else{
+                    CHECK(labs(got - want) <= GRAVITY_TOL, "axis %u gain %d delta %d gives %d, want %ld", axis, gain, delta, got, want);
+                }
+            }
+        }
+    }
+
+    display_B(GRAVITY_MAX, 0);
+    CHECK(second == 9 && first == 9, "GRAVITY_MAX shows %u.%u", second, first);
+    display_B(-GRAVITY_MAX, 1);
+    CHECK(second == 9 && first == 9, "-GRAVITY_MAX shows %u.%u", second, first);
+    display_B(949, 2);
+    CHECK(second == 0 && first == 9, "949 milli-g shows %u.%u", second, first);
+
+    return TEST_RESULT;
+}
@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include "test.h"
+#include "noise.h"
+
+/***************************************************************************
+ * test_hold_4seg.c
+ * Host test for sampleADC() of adc_4seg_display.c
+ *
+ * Turns a potentiometer slowly across its range with a few counts of
+ * noise on every conversion. The reading sent to the display must only
+ * ever step in the direction of the ramp, hold still on a steady input
+ * and follow the input to within the hysteresis band plus noise. The 4seg
+ * band is only two 10-bit counts, so its pot gets one count of noise.
+ *
+ ***************************************************************************/
+
+#define main fw_main
+#include "adc_4seg_display.c"
+#undef main
+
+#define RAMP_STEP   0.02            // 10-bit counts the input moves per reading
+
+int main(void)
+{
+    unsigned int reading, last, changes, i;
+    unsigned long reversals = 0, worst = 0;
+
+    SimAdcHook = noiseSample;
+    NoiseSigma = 1.0;
+
+    NoiseLevel = 50.0;
+    oldVal = last = sampleADC(oldVal);
+    for (NoiseLevel=50.0; NoiseLevel<=950.0; NoiseLevel+=RAMP_STEP){
+        reading = sampleADC(oldVal);
+        oldVal = reading;
+        if (reading < last){reversals++;}
+        if (labs((long)reading - (long)(NoiseLevel * ADC_COUNTS(1))) > (long)worst){
+            worst = labs((long)reading - (long)(NoiseLevel * ADC_COUNTS(1)));
+        }
+        last = reading;
+    }
+    CHECK(reversals == 0, "reading stepped back %lu times on a rising ramp", reversals);
+    CHECK(worst <= ADC_COUNTS(2) + ADC_COUNTS(1), "reading trails the input by up to %lu", worst);
+
+    for (NoiseLevel=950.0; NoiseLevel>=50.0; NoiseLevel-=RAMP_STEP){
+        reading = sampleADC(oldVal);
+        oldVal = reading;
+        if (reading > last){reversals++;}
+        last = reading;
+    }
+    CHECK(reversals == 0, "reading stepped back %lu times on a falling ramp", reversals);
+
+    for (NoiseLevel=100.0; NoiseLevel<=900.0; NoiseLevel+=100.0){
+        oldVal = last = sampleADC(oldVal);
+        for (changes=0, i=0; i<2000; i++){
+            reading = sampleADC(oldVal);
+            oldVal = reading;
+            if (reading != last){changes++;}
+            last = reading;
+        }
+        CHECK(changes <= 1, "reading changed %u times on a steady %.0f", changes, NoiseLevel);
+    }
+
+    return TEST_RESULT;
+}
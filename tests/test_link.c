@@ -0,0 +1,61 @@
+#include <string.h>
+#include <msp430.h>
+#include "test.h"
+#include "lib/link.h"
+
+/***************************************************************************
+ * test_link.c
+ * Host test for the link statistics in lib/link.c
+ *
+ * Feeds linkFrame() frames at intervals on both sides of the 524ms
+ * Timer0_A period, with the arrival times read by linkTime() from the
+ * register stub, and checks the averaged interval, drop and order counts.
+ *
+ ***************************************************************************/
+
+static unsigned long Clock;         // Timer0_A ticks at SMCLK/8
+
+static void arrive(char seq)
+{
+    TA0R = Clock & 0xFFFF;
+    LinkEpoch = Clock >> 16;
+    linkFrame(seq, linkTime());
+}
+
+int main(void)
+{
+    static const unsigned int Periods[] = {100, 500, 600, 1000};
+    unsigned int p, i;
+
+    for (p=0; p<sizeof(Periods)/sizeof(Periods[0]); p++){
+        memset(LinkStats, 0, sizeof(LinkStats));
+        for (i=0; i<40; i++){
+            arrive(SEQ_BASE + (i & (SEQ_COUNT - 1)));
+            Clock += (unsigned long)Periods[p] * LINK_TICKS_MS;
+        }
+        CHECK(LinkStats[LINK_INTERVAL] == Periods[p], "frames every %ums give interval %u", Periods[p], LinkStats[LINK_INTERVAL]);
+        CHECK(LinkStats[LINK_DROPPED] == 0 && LinkStats[LINK_ORDER] == 0, "in order frames every %ums count %u dropped %u out of order",
+              Periods[p], LinkStats[LINK_DROPPED], LinkStats[LINK_ORDER]);
+    }
+
+    /* overflow pending while reading, the ISR has not counted it yet */
+    Clock = 0x2FFFFUL;
+    TA0R = 0x0003;
+    LinkEpoch = 2;
+    TA0CTL |= TAIFG;
+    CHECK(linkTime() == 0x30003UL, "pending overflow gives %#lx", linkTime());
+    TA0R = 0xFFF0;
+    CHECK(linkTime() == 0x2FFF0UL, "overflow flag before a late read gives %#lx", linkTime());
+    TA0CTL &= ~TAIFG;
+
+    memset(LinkStats, 0, sizeof(LinkStats));
+    Clock = 0;
+    arrive(SEQ_BASE + 0);
+    Clock += 1000UL * LINK_TICKS_MS;
+    arrive(SEQ_BASE + 3);
+    CHECK(LinkStats[LINK_DROPPED] == 2, "gap of 2 counts %u dropped", LinkStats[LINK_DROPPED]);
+    arrive(SEQ_BASE + 1);
+    CHECK(LinkStats[LINK_ORDER] == 1, "older frame counts %u out of order", LinkStats[LINK_ORDER]);
+
+    return TEST_RESULT;
+}
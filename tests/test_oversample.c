@@ -0,0 +1,62 @@
+#include <msp430.h>
+#include "test.h"
+#include "lib/adc.h"
+
+/***************************************************************************
+ * test_oversample.c
+ * Host test for adcOversample() of lib/adc.c
+ *
+ * Moves the input in 2^(ADC_RES_BITS-10) steps between two 10-bit codes
+ * with one count of evenly spread dither on the conversions. Every step
+ * must read as its own value at ADC_RES_BITS, which a single 10-bit
+ * conversion cannot resolve, and a steady full scale input must not
+ * read past ADC_MAX.
+ *
+ ***************************************************************************/
+
+#define EXTRA_STEPS (1 << (ADC_RES_BITS - 10))  // input steps within one 10-bit code
+
+unsigned int Code;                  // 10-bit code below the input
+unsigned int Step;                  // input is Code + Step / EXTRA_STEPS
+unsigned int Conversion;            // conversions since the reading started
+
+/*
+ * Function:  ditherSample
+ * ----------------------
+ * SimAdcHook for an input between two codes: of every ADC_SAMPLES
+ * conversions, the share Step / EXTRA_STEPS reads the upper code.
+ *
+ * returns: Code or Code + 1
+ */
+unsigned int ditherSample(void)
+{
+    unsigned int j = Conversion++ % ADC_SAMPLES;
+
+    return Code + (j >= ADC_SAMPLES - (Step * ADC_SAMPLES) / EXTRA_STEPS);
+}
+
+int main(void)
+{
+    unsigned int got, last;
+
+    SimAdcHook = ditherSample;
+
+    for (Code=0; Code<1023; Code++){
+        last = 0;
+        for (Step=0; Step<EXTRA_STEPS; Step++){
+            Conversion = 0;
+            got = adcOversample();
+            CHECK(got == ADC_COUNTS(Code) + Step, "code %u step %u reads %u, want %u",
+                  Code, Step, got, ADC_COUNTS(Code) + Step);
+            CHECK(Step == 0 || got > last, "code %u step %u does not read above step %u", Code, Step, Step - 1);
+            last = got;
+        }
+    }
+
+    SimAdcHook = 0;
+    SimAdc10Mem = 1023;
+    got = adcOversample();
+    CHECK(got == ADC_COUNTS(1023) && got <= ADC_MAX, "full scale reads %u, ADC_MAX %u", got, ADC_MAX);
+
+    return TEST_RESULT;
+}
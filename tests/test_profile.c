@@ -0,0 +1,117 @@
+#include <string.h>
+#include "test.h"
+
+/***************************************************************************
+ * test_profile.c
+ * Host test for the ISR profiler of level_and_distance_sensor.c
+ *
+ * Builds the firmware with ISR_PROFILE set to 1 and runs the ISRs with
+ * Timer1_A moved on by a known number of ticks between the read at
+ * entry and the reads after it. The execution and latency figures, the
+ * log2 histogram of every ISR and the dump sent after a '?' request
+ * must account for exactly those runs.
+ *
+ ***************************************************************************/
+
+#define ISR_PROFILE 1
+#define main fw_main
+#include "level_and_distance_sensor.c"
+#undef main
+
+#define ENTRY 1000                  // Timer1_A count when an ISR starts
+
+unsigned int Ticks;                 // execution time of the next run
+unsigned int Reads;                 // TA1R reads during this run
+char Dump[1024];
+unsigned int DumpLen;
+
+/*
+ * Function:  timer1
+ * ----------------------
+ * SimTimer1Hook, the first read of a run is the ISR entry and every
+ * later one sees the count Ticks on.
+ */
+unsigned int timer1(void)
+{
+    return (Reads++ == 0) ? ENTRY : ENTRY + Ticks;
+}
+
+void tx(char c)
+{
+    if (DumpLen < sizeof(Dump) - 1){
+        Dump[DumpLen++] = c;
+    }
+}
+
+/*
+ * Function:  echo
+ * ----------------------
+ * Runs TIMER1_A1_ISR() for an echo edge captured latency ticks before
+ * the ISR starts, taking ticks to complete.
+ */
+void echo(unsigned int ticks, unsigned int latency)
+{
+    Reads = 0;
+    Ticks = ticks;
+    TA1IV = TA1IV_TACCR1;
+    TA1CCR1 = ENTRY - latency;
+    TIMER1_A1_ISR();
+}
+
+int main(void)
+{
+    static const unsigned int Echo[] = {1, 2, 3, 100, 1000, 2048, 60000};
+    static const unsigned int Latency[] = {4, 6, 8, 10, 12, 14, 16};
+    static const unsigned int EchoBins[PROF_BINS] = {1, 2, 0, 0, 0, 0, 1, 0, 0, 1, 0, 2};
+    struct IsrProfile *prof = &IsrProfiles[PROF_TIMER1_A1];
+    char expect[1024];
+    unsigned long total = 0;
+    unsigned int i;
+
+    SimTimer1Hook = timer1;
+    for (i=0; i<sizeof(Echo)/sizeof(Echo[0]); i++){
+        echo(Echo[i], Latency[i]);
+        total += Echo[i];
+    }
+    CHECK(prof->count == 7 && prof->total == total, "%u echo runs total %lu ticks", prof->count, prof->total);
+    CHECK(prof->min == 1 && prof->max == 60000, "echo runs from %u to %u ticks", prof->min, prof->max);
+    CHECK(prof->latCount == 7 && prof->latTotal == 70 && prof->latMax == 16,
+          "%u echo latencies total %lu max %u", prof->latCount, prof->latTotal, prof->latMax);
+    for (i=0; i<PROF_BINS; i++){
+        CHECK(prof->hist[i] == EchoBins[i], "echo histogram bin %u holds %u runs, not %u", i, prof->hist[i], EchoBins[i]);
+    }
+
+    Reads = 0;
+    Ticks = 5;
+    TA1IV = TA1IV_TAIFG;
+    TIMER1_A1_ISR();
+    CHECK(prof->count == 8 && prof->latCount == 7 && prof->hist[2] == 1, "overflow run not counted without a latency");
+
+    for (i=0; i<3; i++){
+        Reads = 0;
+        Ticks = 40;
+        PORT2_ISR();
+    }
+    prof = &IsrProfiles[PROF_PORT2];
+    CHECK(prof->count == 3 && prof->min == 40 && prof->max == 40 && prof->total == 120 && prof->hist[5] == 3,
+          "button runs n=%u min=%u max=%u", prof->count, prof->min, prof->max);
+
+    Reads = 0;
+    Ticks = 7;
+    UCA0RXBUF = PROF_DUMP_CHAR;
+    USCI0RX_ISR();
+    CHECK(ProfDumpRequest == TRUE, "dump not requested");
+    CHECK(IsrProfiles[PROF_USCI0RX].count == 1 && IsrProfiles[PROF_USCI0RX].hist[2] == 1, "request run not recorded");
+    CHECK(IsrProfiles[PROF_TIMER0_A1].count == 0, "scan ISR recorded without running");
+
+    SimTxHook = tx;
+    profDump();
+    sprintf(expect, "%cTIMER1_A1 n=8 min=1 avg=%lu max=60000 lat=10/16 h=1 2 1 0 0 0 1 0 0 1 0 2\r\n"
+            "PORT2 n=3 min=40 avg=40 max=40 lat=0/0 h=0 0 0 0 0 3 0 0 0 0 0 0\r\n"
+            "USCI0RX n=1 min=7 avg=7 max=7 lat=0/0 h=0 0 1 0 0 0 0 0 0 0 0 0\r\n"
+            "TIMER0_A1 n=0 min=0 avg=0 max=0 lat=0/0 h=0 0 0 0 0 0 0 0 0 0 0 0\r\n%c",
+            FRAME_TEXT_START, (total + 5) / 8, FRAME_TEXT_END);
+    CHECK(strcmp(Dump, expect) == 0, "dump reads\n%s\nnot\n%s", Dump, expect);
+
+    return TEST_RESULT;
+}
@@ -0,0 +1,68 @@
+#include "test.h"
+
+/***************************************************************************
+ * test_quantizer.c
+ * Host test for adc_7seg.c
+ *
+ * Runs ADC_sample() on every 10-bit code starting from every shown hex
+ * character and compares against the if/else ladder the shift quantizer
+ * replaced: 16 bands of 64 codes, the top 2 codes of bands 0 to e keep
+ * the previous character and band f starts at 960.
+ *
+ ***************************************************************************/
+
+#define main fw_main
+#include "adc_7seg.c"
+#undef main
+
+/*
+ * Function:  ladder
+ * ----------------------
+ * The band limits of the original ADC_sample() ladder.
+ *
+ * returns: hex character for code, prev inside the 2 code buffers
+ */
+char ladder(unsigned int code, char prev)
+{
+    unsigned int i;
+
+    if (code >= 960){return 'f';}
+    for (i=0; i<15; i++){
+        if ((code >= 64*i) && (code < 64*i + 62)){return HexChar[i];}
+    }
+    return prev;
+}
+
+int main(void)
+{
+    unsigned int code, start;
+    char got, want;
+
+    for (start=0; start<16; start++){
+        for (code=0; code<1024; code++){
+            val = HexChar[start];
+            SimAdc10Mem = code;
+            got = ADC_sample();
+            want = ladder(code, HexChar[start]);
+            CHECK(got == want, "code %u from '%c' gives '%c', ladder '%c'", code, HexChar[start], got, want);
+            CHECK(ADC_Read == code, "code %u read as %u", code, ADC_Read);
+        }
+    }
+
+    /* a slow ramp up and back down steps through every character once */
+    val = '0';
+    for (start=0, code=0; code<1024; code++){
+        char prev = val;
+        SimAdc10Mem = code;
+        if (ADC_sample() != prev){start++;}
+    }
+    CHECK(start == 15 && val == 'f', "ramp up changes %u times", start);
+    for (start=0, code=1024; code-->0;){
+        char prev = val;
+        SimAdc10Mem = code;
+        if (ADC_sample() != prev){start++;}
+    }
+    CHECK(start == 15 && val == '0', "ramp down changes %u times", start);
+
+    return TEST_RESULT;
+}
@@ -0,0 +1,196 @@
+#include <setjmp.h>
+#include <string.h>
+#include "test.h"
+
+/***************************************************************************
+ * test_replay.c
+ * Host test for the sensor role of level_and_distance_sensor.c
+ *
+ * Replays a raw input capture, as streamed by the sensor built with
+ * CAPTURE set to 1, through the main loop of the unchanged firmware.
+ * Each record's adc_samples[] words are put where the ADC10 transfer
+ * would have left them and its Travel_time arrives as a rising and a
+ * falling edge captured in TA1CCR1 by TIMER1_A1_ISR(). The frame sent
+ * after every record must match the expected frames, and the steady
+ * parts of the capture must read what their inputs say.
+ *
+ * tests/replay/level.scap stands in for a field recording: 100cm then
+ * 25cm with echo jitter, the board flat, then tilted about 30 degrees
+ * on X and -14 on Y, and one record corrupted on the wire. After an
+ * intended change the expected frames are written again with
+ *
+ *   build/host/test_replay -w > tests/replay/level.frames
+ *
+ ***************************************************************************/
+
+#define main fw_main
+#include "level_and_distance_sensor.c"
+#undef main
+
+#define CAPTURE_FILE    "tests/replay/level.scap"
+#define FRAMES_FILE     "tests/replay/level.frames"
+#define RECORDS_MAX     256
+
+void USCI0TX_ISR(void);             // lib/link.c
+
+struct Record {
+    char mode;
+    unsigned int time;              // 256us units
+    unsigned int travel;            // raw Travel_time
+    unsigned int samples[8];        // adc_samples[] as the loop read them
+};
+
+struct Record Records[RECORDS_MAX];
+unsigned int RecordCount, Rejected, Fed;
+char Frames[RECORDS_MAX][FRAME_SIZE];
+jmp_buf Done;
+
+/*
+ * Function:  readCapture
+ * ----------------------
+ * Loads the records of a capture file, checking the header and skipping
+ * records whose xor does not match.
+ *
+ * returns: 0 when the file is a capture of this version, else -1
+ */
+int readCapture(const char *name)
+{
+    FILE *in = fopen(name, "rb");
+    unsigned char buf[CAPTURE_RECORD];
+    unsigned int i;
+
+    if (in == NULL){
+        perror(name);
+        return -1;
+    }
+    if (fread(buf, 1, 6, in) != 6 || memcmp(buf, "SCAP", 4) != 0
+        || buf[4] != CAPTURE_VERSION || buf[5] != CAPTURE_RECORD){
+        printf("%s: not a version %u capture\n", name, CAPTURE_VERSION);
+        fclose(in);
+        return -1;
+    }
+    while (RecordCount < RECORDS_MAX && fread(buf, 1, CAPTURE_RECORD, in) == CAPTURE_RECORD){
+        struct Record *rec = &Records[RecordCount];
+        unsigned char check = 0;
+
+        for (i=1; i<CAPTURE_RECORD; i++){check ^= buf[i];}
+        if (buf[0] != CAPTURE_SYNC || check != 0){
+            Rejected++;
+            continue;
+        }
+        rec->mode = buf[1];
+        rec->time = buf[2] | (buf[3] << 8);
+        rec->travel = buf[4] | (buf[5] << 8);
+        for (i=0; i<8; i++){
+            rec->samples[i] = buf[6 + 2*i] | (buf[7 + 2*i] << 8);
+        }
+        RecordCount++;
+    }
+    fclose(in);
+    return 0;
+}
+
+/*
+ * Function:  feed
+ * ----------------------
+ * Sets the inputs the next main loop pass reads from a record: the
+ * mode, the ADC10 transfer block and an echo pulse on TA1CCR1.
+ */
+void feed(const struct Record *rec)
+{
+    unsigned int i;
+
+    System = (rec->mode == MODE_DISTANCE) ? DISTANCE : ANGLE;
+    for (i=0; i<8; i++){
+        adc_samples[i] = rec->samples[i];
+    }
+
+    TA1IV = TA1IV_TACCR1;
+    TA1CCTL1 |= CCI;                                // rising edge
+    TA1CCR1 = rec->time;
+    TIMER1_A1_ISR();
+    TA1IV = TA1IV_TACCR1;
+    TA1CCTL1 &= ~CCI;                               // falling edge
+    TA1CCR1 = rec->time + rec->travel;
+    TIMER1_A1_ISR();
+}
+
+/*
+ * Function:  loopWait
+ * ----------------------
+ * SimDelayHook. The first busy wait after linkSend() ends a loop pass:
+ * sends the frame, then feeds the next record or leaves fw_main().
+ */
+void loopWait(unsigned long cycles)
+{
+    unsigned int i;
+
+    (void) cycles;
+    if (!(IE2 & UCA0TXIE)){return;}
+    for (i=0; i<FRAME_SIZE; i++){
+        USCI0TX_ISR();
+        Frames[Fed][i] = UCA0TXBUF;
+    }
+    if (++Fed >= RecordCount){longjmp(Done, 1);}
+    feed(&Records[Fed]);
+}
+
+/*
+ * Function:  frameLine
+ * ----------------------
+ * Writes a frame as mode, value and signs, leaving out the sequence.
+ */
+void frameLine(char *line, const char *frame)
+{
+    sprintf(line, "%c %d %c", frame[FRAME_MODE], frameValue(frame), frame[FRAME_SIGNS]);
+}
+
+int main(int argc, char *argv[])
+{
+    int write = (argc > 1) && (strcmp(argv[1], "-w") == 0);
+    char line[32], want[32];
+    unsigned int i;
+    FILE *frames;
+
+    if (readCapture(CAPTURE_FILE) < 0){return 1;}
+    CHECK(RecordCount == 54 && Rejected == 1, "%u records read, %u rejected", RecordCount, Rejected);
+
+    simFlashInit();                                 // new device, default calibration
+    SimDelayHook = loopWait;
+    feed(&Records[0]);
+    if (setjmp(Done) == 0){
+        fw_main();
+    }
+    CHECK(Fed == RecordCount, "%u frames for %u records", Fed, RecordCount);
+
+    if (write){
+        for (i=0; i<Fed; i++){
+            frameLine(line, Frames[i]);
+            printf("%s\n", line);
+        }
+        return 0;
+    }
+
+    frames = fopen(FRAMES_FILE, "r");
+    if (frames == NULL){
+        perror(FRAMES_FILE);
+        return 1;
+    }
+    for (i=0; i<Fed && fgets(want, sizeof(want), frames); i++){
+        want[strcspn(want, "\r\n")] = 0;
+        frameLine(line, Frames[i]);
+        CHECK(strcmp(line, want) == 0, "record %u sends \"%s\", expected \"%s\"", i, line, want);
+    }
+    CHECK(i == Fed, "%s holds %u of %u frames", FRAMES_FILE, i, Fed);
+    fclose(frames);
+
+    /* the end of every steady part reads what its inputs say */
+    CHECK(Frames[13][FRAME_MODE] == MODE_DISTANCE && abs(frameValue(Frames[13]) - 100) <= 1,
+          "100cm reads %d", frameValue(Frames[13]));
+    CHECK(abs(frameValue(Frames[27]) - 25) <= 1, "25cm reads %d", frameValue(Frames[27]));
+    CHECK(Frames[39][FRAME_MODE] == MODE_ANGLE && frameValue(Frames[39]) == 0, "flat reads %d", frameValue(Frames[39]));
+    CHECK(frameValue(Frames[53]) / 100 == 29 && frameValue(Frames[53]) % 100 == 14 && Frames[53][FRAME_SIGNS] == SIGN_BASE + SIGN_Y,
+          "tilt reads %d signs %c", frameValue(Frames[53]), Frames[53][FRAME_SIGNS]);
+
+    return TEST_RESULT;
+}
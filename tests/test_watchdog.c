@@ -0,0 +1,68 @@
+#include <msp430.h>
+#include "test.h"
+#include "lib/flash.h"
+#include "lib/watchdog.h"
+
+/***************************************************************************
+ * test_watchdog.c
+ * Host test for lib/watchdog.c
+ *
+ * The watchdog is fed only once every task in the mask checked in. A
+ * watchdog reset is counted in the log in information segment D with
+ * the tasks that had checked in, other resets leave the flash alone and
+ * a corrupted log starts over.
+ *
+ ***************************************************************************/
+
+#define LOG ((const struct ResetLog *) INFO_SEG(INFO_D))
+
+/*
+ * Function:  reset
+ * ----------------------
+ * Starts up after a reset, a watchdog one when wdt is set.
+ */
+void reset(int wdt)
+{
+    IFG1 = wdt ? WDTIFG : 0;
+    WDTCTL = WDTPW | WDTHOLD;
+    watchdogStart();
+}
+
+int main(void)
+{
+    unsigned int i;
+
+    simFlashInit();
+    Heartbeat = 0x5A5A;             // noinit, anything after a power up
+    reset(0);
+    CHECK(WdtResets == 0 && SimFlashErases[INFO_D] == 0, "power up counts %u resets, %lu erases", WdtResets, SimFlashErases[INFO_D]);
+    CHECK(WDTCTL == WDT_FEED && BCSCTL3 == LFXT1S_2, "watchdog not started from the VLO");
+    CHECK(Heartbeat == 0, "heartbeats kept over the start");
+
+    WDTCTL = 0;
+    HEARTBEAT(BIT0);
+    supervise(BIT0 + BIT1);
+    CHECK(WDTCTL == 0 && Heartbeat == BIT0, "fed with a task missing");
+    HEARTBEAT(BIT1);
+    supervise(BIT0 + BIT1);
+    CHECK(WDTCTL == WDT_FEED && Heartbeat == 0, "not fed once every task checked in");
+
+    for (i=1; i<=3; i++){
+        Heartbeat = BIT1;           // BIT0 hung before the reset
+        reset(1);
+        CHECK(WdtResets == i && LOG->wdtResets == i && LOG->lastBeats == BIT1, "watchdog reset %u counted as %u, beats %u",
+              i, WdtResets, LOG->lastBeats);
+        CHECK((IFG1 & WDTIFG) == 0, "reset cause not cleared");
+    }
+    reset(0);
+    CHECK(WdtResets == 3 && SimFlashErases[INFO_D] == 3, "power up after 3 watchdog resets counts %u, %lu erases",
+          WdtResets, SimFlashErases[INFO_D]);
+
+    simFlashFlip(INFO_D, 1, 4);
+    reset(0);
+    CHECK(WdtResets == 0, "corrupted log read as %u resets", WdtResets);
+    reset(1);
+    CHECK(WdtResets == 1 && LOG->wdtResets == 1, "log started over at %u", WdtResets);
+
+    return TEST_RESULT;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/***************************************************************************
+ * capture_decode.c
+ * Host tool for level_and_distance_sensor.c
+ *
+ * Decodes a raw input capture streamed by the sensor MCU built with
+ * CAPTURE set to 1 into one CSV row per main loop: the mode, the
+ * unwrapped time, the raw Travel_time and all eight adc_samples[] words.
+ * Records failing their checksum are counted and skipped, so a capture
+ * started part way through a record resynchronizes on the next one.
+ *
+ * Usage: capture_decode [capture.bin] > capture.csv
+ *
+ ***************************************************************************/
+
+#define CAPTURE_VERSION 1           // must match level_and_distance_sensor.c
+#define CAPTURE_SYNC    0xA5
+#define CAPTURE_RECORD  23          // bytes per record including sync and xor
+#define TICK_US         256         // one timestamp count in microseconds
+
+/* Function Prototypes */
+int checkHeader(const unsigned char*);
+int decodeRecord(const unsigned char*, unsigned long*, int*);
+
+int main(int argc, char *argv[])
+{
+    FILE *in = stdin;
+    unsigned char buf[CAPTURE_RECORD];
+    unsigned long time = 0;
+    unsigned int fill = 0, records = 0, bad = 0;
+    int first = 1;
+    int c;
+
+    if (argc > 1){
+        in = fopen(argv[1], "rb");
+        if (in == NULL){
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    printf("time_us,mode,travel_time,a0,a1,a2,a3,a4,a5,a6,a7\n");
+
+    while ((c = fgetc(in)) != EOF){
+        buf[fill++] = c;
+
+        if (buf[0] != CAPTURE_SYNC && buf[0] != 'S'){
+            fill = 0;                                   // hunt for a record or header
+            continue;
+        }
+        if (buf[0] == 'S' && fill == 6){
+            if (checkHeader(buf) < 0){
+                fclose(in);
+                return 1;
+            }
+            fill = 0;
+            continue;
+        }
+        if (buf[0] == CAPTURE_SYNC && fill == CAPTURE_RECORD){
+            if (decodeRecord(buf, &time, &first)){
+                records++;
+                fill = 0;
+            }
+            else{
+                unsigned int i, next = 0;               // resync on the next sync byte
+                bad++;
+                for (i=1; i<fill; i++){
+                    if (buf[i] == CAPTURE_SYNC){next = i; break;}
+                }
+                for (i=0; next && i<fill-next; i++){
+                    buf[i] = buf[next+i];
+                }
+                fill = next ? fill - next : 0;
+            }
+        }
+        if (fill >= CAPTURE_RECORD){fill = 0;}
+    }
+
+    fprintf(stderr, "%u record(s) decoded, %u rejected\n", records, bad);
+    if (in != stdin){fclose(in);}
+    return 0;
+}
+
+/*
+ * Function:  checkHeader
+ * ----------------------
+ * Checks a 'S' 'C' 'A' 'P' version length header.
+ *
+ * returns: 0 when the capture can be decoded, 1 when the bytes were
+ *          not a header, -1 for an unsupported version
+ */
+int checkHeader(const unsigned char *hdr)
+{
+    if (hdr[1] != 'C' || hdr[2] != 'A' || hdr[3] != 'P'){
+        return 1;
+    }
+    if (hdr[4] != CAPTURE_VERSION || hdr[5] != CAPTURE_RECORD){
+        fprintf(stderr, "unsupported capture version %u, record length %u\n", hdr[4], hdr[5]);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Function:  decodeRecord
+ * ----------------------
+ * Verifies the checksum of one record and prints it as a CSV row.
+ * The 16-bit timestamp is unwrapped against the previous record.
+ *
+ * returns: 1 when the record was valid, 0 otherwise
+ */
+int decodeRecord(const unsigned char *rec, unsigned long *time, int *first)
+{
+    static unsigned int prevTick;
+    unsigned char check = 0;
+    unsigned int tick, i;
+
+    for (i=1; i<CAPTURE_RECORD-1; i++){
+        check ^= rec[i];
+    }
+    if (check != rec[CAPTURE_RECORD-1] || (rec[1] != 'D' && rec[1] != 'A')){
+        return 0;
+    }
+
+    tick = rec[2] | (rec[3] << 8);
+    if (!*first){
+        *time += ((tick - prevTick) & 0xFFFF) * (unsigned long)TICK_US;
+    }
+    *first = 0;
+    prevTick = tick;
+
+    printf("%lu,%c,%u", *time, rec[1], rec[4] | (rec[5] << 8));
+    for (i=0; i<8; i++){
+        printf(",%u", rec[6 + 2*i] | (rec[7 + 2*i] << 8));
+    }
+    printf("\n");
+    return 1;
+}
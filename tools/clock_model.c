@@ -0,0 +1,168 @@
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***************************************************************************
+ * clock_model.c
+ * Host tool for level_and_distance_sensor.c
+ *
+ * Energy and latency of one sample period of the sensor MCU under three
+ * clock policies: MCLK fixed at 1MHz as before clock scaling, MCLK fixed
+ * at the burst clock, and the scaled clock the firmware uses. The main
+ * loop runs on the register stub after startup(), so the divider
+ * settings are the ClockFast and ClockSlow it left in BCSCTL2 and every
+ * busy wait is counted in MCLK cycles at the divider set when it ran.
+ *
+ * The stub does not execute instructions, so the compute work of a
+ * sample (angle math, frame encoding) is given in MCLK cycles. Take it
+ * from the TASK_MEASURE and TASK_OUTPUT times of a LOOP_PROFILE build,
+ * which are SMCLK ticks, times the burst MCLK in MHz. Active current is
+ * a linear fit to the MSP430G2553 datasheet typicals at 3V, 330uA at
+ * 1MHz and about 4.2mA at 16MHz; it leaves out the DCO still running at
+ * the burst frequency while MCLK is divided, so the scaled figure is
+ * slightly low.
+ *
+ * Usage: clock_model [-c compute_cycles] [-m a|d] [-p period_ms]
+ *                    [-n samples]
+ *
+ ***************************************************************************/
+
+#define main fw_main
+#include "level_and_distance_sensor.c"
+#undef main
+
+#define IA_BASE_UA      70.0        // active current at 0Hz, fitted
+#define IA_PER_MHZ_UA   260.0       // active current per MHz of MCLK
+
+struct Policy {
+    const char *name;
+    double burstMhz;                // MCLK while computing and sending
+    double idleMhz;                 // MCLK in the wait for the next sample
+};
+
+static unsigned long BurstCycles, IdleCycles;   // MCLK cycles waited in each state
+static unsigned int IdleWaits, WaitsPerSample, Samples = 10;
+static unsigned long Compute = 20000;            // MCLK cycles of work per sample
+static jmp_buf Done;
+
+/* Function Prototypes */
+double mclkMhz(unsigned char);
+double activeUa(double);
+void countWait(unsigned long);
+void model(const struct Policy*, double, double, double);
+
+int main(int argc, char *argv[])
+{
+    double burstUs, idleUs;
+    int i;
+
+    for (i=1; i<argc; i++){
+        if (!strcmp(argv[i], "-c") && i+1 < argc){
+            Compute = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-m") && i+1 < argc){
+            i++;
+            System = (argv[i][0] == 'd') ? DISTANCE : ANGLE;
+        }
+        else if (!strcmp(argv[i], "-p") && i+1 < argc){
+            SamplePeriod = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-n") && i+1 < argc){
+            Samples = strtoul(argv[++i], NULL, 10);
+        }
+        else{
+            fprintf(stderr, "usage: clock_model [-c compute_cycles] [-m a|d] [-p period_ms] [-n samples]\n");
+            return 1;
+        }
+    }
+    if (SamplePeriod < SAMPLE_STEP || Samples == 0){
+        fprintf(stderr, "period must be at least %dms, samples above 0\n", SAMPLE_STEP);
+        return 1;
+    }
+    WaitsPerSample = (SamplePeriod + SAMPLE_STEP - 1) / SAMPLE_STEP;
+
+    simFlashInit();
+    SimDelayHook = countWait;
+    if (setjmp(Done) == 0){
+        fw_main();
+    }
+
+    burstUs = BurstCycles / mclkMhz(ClockFast) / Samples;
+    idleUs = IdleCycles / mclkMhz(ClockSlow) / Samples;
+    printf("DCO %dMHz, BCSCTL2 0x%02X in bursts (MCLK %.0fMHz) and 0x%02X idle (MCLK %.0fMHz)\n",
+           MCLK_MHZ, ClockFast, mclkMhz(ClockFast), ClockSlow, mclkMhz(ClockSlow));
+    printf("per %s sample: %lu compute cycles, %.0fus of waits in bursts, %.0fus idle\n\n",
+           (System == DISTANCE) ? "distance" : "angle", Compute, burstUs, idleUs);
+    printf("%-12s %9s %9s %10s %10s %12s %10s\n",
+           "policy", "burst", "idle", "burst us", "period us", "MCLK cycles", "avg uA");
+    {
+        const struct Policy Policies[] = {
+            {"fixed 1MHz", 1.0, 1.0},
+            {"fixed fast", mclkMhz(ClockFast), mclkMhz(ClockFast)},
+            {"scaled", mclkMhz(ClockFast), mclkMhz(ClockSlow)},
+        };
+
+        for (i=0; i<3; i++){
+            model(&Policies[i], Compute, burstUs, idleUs);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Function:  mclkMhz
+ * ----------------------
+ * MCLK of a BCSCTL2 setting, the DCO on its MCLK_MHZ calibration
+ * divided by DIVM.
+ */
+double mclkMhz(unsigned char bcsctl2)
+{
+    return (double)MCLK_MHZ / (1 << ((bcsctl2 & DIVM_3) >> 4));
+}
+
+double activeUa(double mhz)
+{
+    return IA_BASE_UA + IA_PER_MHZ_UA * mhz;
+}
+
+/*
+ * Function:  countWait
+ * ----------------------
+ * SimDelayHook, adds a busy wait to the clock state it ran in. The
+ * first sample includes startup and is not counted; the loop is left
+ * once the given number of samples has waited its full period.
+ */
+void countWait(unsigned long cycles)
+{
+    if (BCSCTL2 == ClockSlow){
+        IdleCycles += cycles;
+        if (++IdleWaits == WaitsPerSample){
+            BurstCycles = IdleCycles = 0;           // end of the first sample
+        }
+        else if (IdleWaits == (Samples + 1) * WaitsPerSample){
+            longjmp(Done, 1);
+        }
+    }
+    else{
+        BurstCycles += cycles;
+    }
+}
+
+/*
+ * Function:  model
+ * ----------------------
+ * Prints the burst latency, sample period, MCLK cycles and average
+ * current of one sample under a policy. Waits take the same time at
+ * any clock, compute takes its cycles at the burst MCLK.
+ */
+void model(const struct Policy *policy, double compute, double burstUs, double idleUs)
+{
+    double burst = compute / policy->burstMhz + burstUs;
+    double period = burst + idleUs;
+    double cycles = burst * policy->burstMhz + idleUs * policy->idleMhz;
+    double charge = activeUa(policy->burstMhz) * burst + activeUa(policy->idleMhz) * idleUs;
+
+    printf("%-12s %6.0fMHz %6.0fMHz %10.0f %10.0f %12.0f %10.0f\n", policy->name,
+           policy->burstMhz, policy->idleMhz, burst, period, cycles, charge / period);
+}
@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/***************************************************************************
+ * frame_view.c
+ * Host tool for adc_uart_display.c
+ *
+ * End to end simulation of the two MCU ADC display. The firmware is built
+ * against the register stub in sim/ and forked into two processes, one
+ * per role, so each MCU has its own registers and globals. The sensor MCU
+ * runs its Timer_A() sample tick and main loop body on a potentiometer
+ * that steps to a new random level every step period, and its TX ISR
+ * puts the frame bytes on a virtual UART timed at the given baud rate.
+ * The display MCU gets each byte through USCI0RX_ISR() when its stop bit
+ * arrives, with independent bit errors injected, runs its main loop
+ * body, receive and display() included, and the P1OUT/P2OUT pattern held
+ * during every busy wait of display() is decoded back into digits.
+ *
+ * Prints a CSV line when the input steps, when the decoded display
+ * changes and when the display first shows a reading taken after a
+ * step, with the latency from the step. A summary goes to stderr.
+ *
+ * Usage: frame_view [-b baud] [-e bit_error_rate] [-s seed] [-t step_ms]
+ *                   [-n steps]
+ *
+ ***************************************************************************/
+
+#define main fw_main
+#include "adc_uart_display.c"
+#undef main
+
+#define BITS_PER_BYTE   10          // start + 8 data + stop
+#define CONVERSION_US   62          // one ADC10 conversion, 64 + 13 ADC10CLK at ADC10OSC/4
+#define MAX_STEPS       1000
+#define TAIL_US         500000UL    // display time simulated after the last step
+
+/* A byte on the virtual UART and the frame it belongs to */
+struct WireByte {
+    unsigned long us;               // stop bit received by the display MCU
+    unsigned int step;              // input step the frame was sampled in
+    unsigned int value;             // reading the frame carries
+    unsigned char byte;
+};
+
+/* Setup shared by both MCUs, fixed before the fork */
+static unsigned long ByteUs, StepUs = 1030000UL;     // steps drift across the sample period
+static unsigned int Steps = 10;
+static unsigned int Levels[MAX_STEPS];  // input per step in 10-bit counts
+
+/* Sensor MCU */
+static unsigned int Input;
+static unsigned long Conversions;
+
+/* Display MCU, MCLK and SMCLK at 1MHz so a cycle is a microsecond */
+static const unsigned char PlacePins[DIGIT_COUNT] = {BIT6, BIT3, BIT4, BIT5};   // as display()
+static char Decode[256];            // P2OUT pattern to digit
+static FILE *Wire;
+static struct WireByte Next;
+static int NextValid = 0;
+static unsigned long Now = 0;
+static double Ber = 0.0;
+static char Seen[DIGIT_COUNT + 1];  // places lit during the last display()
+static struct WireByte Arrived, Shown;  // last byte of the frame received and of the one shown
+static long Latency[MAX_STEPS];
+static unsigned long Bytes = 0, Frames = 0, Flipped = 0, Overruns = 0;
+
+/* Function Prototypes */
+void USCI0TX_ISR(void);             // lib/link.c
+unsigned int sensorAdc(void);
+void sensorTx(unsigned long, struct WireByte*, FILE*);
+void sensorRun(FILE*);
+void timerSet(void);
+void displayDelay(unsigned long);
+void displayRx(void);
+void displayShow(void);
+void displayRun(void);
+void report(void);
+
+int main(int argc, char *argv[])
+{
+    unsigned long baud = 9600, seed = 1;
+    int pipefd[2];
+    pid_t pid;
+    int i;
+
+    for (i=1; i<argc; i++){
+        if (!strcmp(argv[i], "-b") && i+1 < argc){
+            baud = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-e") && i+1 < argc){
+            Ber = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-s") && i+1 < argc){
+            seed = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-t") && i+1 < argc){
+            StepUs = strtoul(argv[++i], NULL, 10) * 1000UL;
+        }
+        else if (!strcmp(argv[i], "-n") && i+1 < argc){
+            Steps = strtoul(argv[++i], NULL, 10);
+        }
+        else{
+            fprintf(stderr, "usage: frame_view [-b baud] [-e bit_error_rate] [-s seed] [-t step_ms] [-n steps]\n");
+            return 1;
+        }
+    }
+    if (baud == 0 || StepUs == 0 || Steps == 0 || Steps > MAX_STEPS){
+        fprintf(stderr, "baud rate and step time must be above 0, steps 1 to %d\n", MAX_STEPS);
+        return 1;
+    }
+    ByteUs = (BITS_PER_BYTE * 1000000UL + baud / 2) / baud;
+
+    srand(seed);
+    for (i=0; i<(int)Steps; i++){
+        Levels[i] = rand() % 1024;
+    }
+
+    fflush(stdout);
+    if (pipe(pipefd) < 0 || (pid = fork()) < 0){
+        perror("frame_view");
+        return 1;
+    }
+    if (pid == 0){                                  // sensor MCU
+        close(pipefd[0]);
+        srand(seed + 1);
+        Wire = fdopen(pipefd[1], "wb");
+        sensorRun(Wire);
+        fclose(Wire);
+        _exit(0);
+    }
+
+    close(pipefd[1]);                               // display MCU
+    Wire = fdopen(pipefd[0], "rb");
+    displayRun();
+    fclose(Wire);
+    waitpid(pid, NULL, 0);
+    report();
+    return 0;
+}
+
+/*
+ * Function:  sensorAdc
+ * ----------------------
+ * ADC10MEM of the sensor MCU: the potentiometer level with one count of
+ * noise.
+ *
+ * returns: 10-bit conversion result
+ */
+unsigned int sensorAdc(void)
+{
+    int val = (int)Input + rand() % 3 - 1;
+
+    Conversions++;
+    if (val < 0){return 0;}
+    if (val > 1023){return 1023;}
+    return val;
+}
+
+/*
+ * Function:  sensorTx
+ * ----------------------
+ * Runs USCI0TX_ISR() for every byte that starts before until, one byte
+ * time apart from *tx, and puts the bytes on the wire.
+ */
+void sensorTx(unsigned long until, struct WireByte *out, FILE *wire)
+{
+    while ((IE2 & UCA0TXIE) && out->us < until){
+        USCI0TX_ISR();
+        out->us += ByteUs;                          // stop bit of this byte
+        out->byte = UCA0TXBUF;
+        fwrite(out, sizeof(*out), 1, wire);
+    }
+}
+
+/*
+ * Function:  sensorRun
+ * ----------------------
+ * Runs the sensor MCU until the last input step ends. The sample period
+ * comes from the Timer_A setup of portInit0(), the time to send from the
+ * ADC conversions sampleADC() made.
+ */
+void sensorRun(FILE *wire)
+{
+    struct WireByte out = {0, 0, 0, 0};
+    unsigned long period, t, ready;
+    unsigned int readVal, busy;
+
+    portInit0();
+    period = (unsigned long)(TACCR0 + 1) << ((TACTL & ID_3) >> 6);    // SMCLK at 1MHz
+    SimAdcHook = sensorAdc;
+
+    for (t=period; t<Steps*StepUs; t+=period){
+        sensorTx(t, &out, wire);
+        Input = Levels[t / StepUs];
+        Timer_A();
+        Conversions = 0;
+        if (Flag == Sample){                        // main loop of MCU0
+            readVal = sampleADC();
+            convertADC(readVal);
+            busy = IE2 & UCA0TXIE;
+            linkSend();
+            OldVal = readVal;
+            Flag = Stop;
+            if (!busy){                             // frame taken, TX starts once sampled
+                ready = t + Conversions * CONVERSION_US;
+                out.us = (out.us > ready) ? out.us : ready;
+                out.step = t / StepUs;
+                out.value = readVal;
+            }
+        }
+    }
+    sensorTx((unsigned long)-1, &out, wire);
+}
+
+/*
+ * Function:  timerSet
+ * ----------------------
+ * Timer0_A of the display MCU at SMCLK/8 and the overflows its TAIFG
+ * interrupt has counted by now.
+ */
+void timerSet(void)
+{
+    TA0R = (Now >> 3) & 0xFFFF;
+    LinkEpoch = Now >> 19;
+}
+
+/*
+ * Function:  displayDelay
+ * ----------------------
+ * Busy wait of the display MCU. Notes the digit lit by P1OUT and P2OUT
+ * for the wait and receives every byte whose stop bit arrives during it.
+ */
+void displayDelay(unsigned long cycles)
+{
+    unsigned long end = Now + cycles;
+    unsigned int place;
+
+    for (place=0; place<DIGIT_COUNT; place++){
+        if (P1OUT & PlacePins[place]){
+            Seen[DIGIT_COUNT - 1 - place] = Decode[P2OUT];
+        }
+    }
+
+    while (NextValid && Next.us <= end){
+        int bit;
+
+        Now = Next.us;
+        timerSet();
+        for (bit=0; bit<8; bit++){                  // inject independent bit errors
+            if (Ber > 0.0 && rand() < Ber * ((double)RAND_MAX + 1.0)){
+                Next.byte ^= 1 << bit;
+                Flipped++;
+            }
+        }
+        Bytes++;
+        if (IFG2 & UCA0RXIFG){Overruns++;}          // previous byte never read
+        UCA0RXBUF = Next.byte;
+        IFG2 |= UCA0RXIFG;
+        Arrived = Next;
+        displayRx();
+        NextValid = fread(&Next, sizeof(Next), 1, Wire) == 1;
+    }
+    Now = end;
+    timerSet();
+}
+
+/*
+ * Function:  displayRx
+ * ----------------------
+ * Runs USCI0RX_ISR() for a received byte while the RX interrupt is
+ * enabled. With it disabled the byte waits in UCA0RXBUF and the next
+ * one overruns it.
+ */
+void displayRx(void)
+{
+    if ((IFG2 & UCA0RXIFG) && (IE2 & UCA0RXIE)){
+        IFG2 &= ~UCA0RXIFG;
+        USCI0RX_ISR();
+    }
+}
+
+/*
+ * Function:  displayShow
+ * ----------------------
+ * Prints the decoded display when it changed and the latency of the
+ * step once the display shows the reading of a frame sampled in it.
+ */
+void displayShow(void)
+{
+    static char last[DIGIT_COUNT + 1] = "";
+    char *end;
+    long val;
+
+    if (strcmp(Seen, last) != 0){
+        strcpy(last, Seen);
+        printf("%.1f,shown,\"%s\"\n", Now / 1000.0, Seen);
+    }
+    val = strtol(Seen, &end, 10);
+    if (end != Seen && *end == '\0' && val == (long)Shown.value && Latency[Shown.step] < 0){
+        Latency[Shown.step] = Now - Shown.step * StepUs;
+        printf("%.1f,latency,%.1f\n", Now / 1000.0, Latency[Shown.step] / 1000.0);
+    }
+}
+
+/*
+ * Function:  displayRun
+ * ----------------------
+ * Runs the main loop body of the display MCU until the wire is empty
+ * and TAIL_US has passed after the last step.
+ */
+void displayRun(void)
+{
+    unsigned int stepped = 0, d;
+
+    memset(Decode, '?', sizeof(Decode));
+    Decode[SEG_OFF] = ' ';
+    for (d=0; d<10; d++){
+        Decode[segmentDigit(d)] = '0' + d;
+    }
+    for (d=0; d<Steps; d++){
+        Latency[d] = -1;
+    }
+
+    portInit1();
+    SimDelayHook = displayDelay;
+    NextValid = fread(&Next, sizeof(Next), 1, Wire) == 1;
+    printf("time_ms,event,value\n");
+
+    while (NextValid || Now < Steps * StepUs + TAIL_US){
+        while (stepped < Steps && stepped * StepUs <= Now){
+            printf("%.1f,input,%u\n", stepped * StepUs / 1000.0, ADC_COUNTS(Levels[stepped]));
+            stepped++;
+        }
+        if (Flag == Save){                          // main loop of MCU1
+            linkReceive();
+            linkFrame(Digits[FRAME_SEQ], linkTime());
+            Flag = Stop;
+            Shown = Arrived;
+            Frames++;
+            displayRx();                            // a byte held while RX was off
+        }
+        else{
+            if (LinkShown){
+                frameEncode(Digits, LinkStats[LinkShown - 1] > 9999 ? 9999 : LinkStats[LinkShown - 1]);
+            }
+            memset(Seen, ' ', DIGIT_COUNT);
+            Seen[DIGIT_COUNT] = '\0';
+            display();
+            displayShow();
+        }
+    }
+}
+
+/*
+ * Function:  report
+ * ----------------------
+ * Summary of the link and of the step to display latency.
+ */
+void report(void)
+{
+    long min = -1, max = -1;
+    double sum = 0.0;
+    unsigned int i, shown = 0;
+
+    for (i=0; i<Steps; i++){
+        if (Latency[i] < 0){continue;}
+        if (min < 0 || Latency[i] < min){min = Latency[i];}
+        if (Latency[i] > max){max = Latency[i];}
+        sum += Latency[i];
+        shown++;
+    }
+    fprintf(stderr, "%lu bytes, %lu frames shown, %u malformed, %lu overrun, %lu bits flipped\n",
+            Bytes, Frames, LinkStats[LINK_MALFORMED], Overruns, Flipped);
+    if (shown > 0){
+        fprintf(stderr, "input to display latency over %u of %u steps: min %.1f avg %.1f max %.1f ms\n",
+                shown, Steps, min / 1000.0, sum / shown / 1000.0, max / 1000.0);
+    }
+    else{
+        fprintf(stderr, "no step reached the display\n");
+    }
+}
@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***************************************************************************
+ * stack_depth.c
+ * Host tool for the firmware build
+ *
+ * Worst case stack depth of every entry point of a firmware image. The
+ * call graph comes from the objdump -d disassembly of the image, the
+ * frame size of each function from the .su files gcc writes with
+ * -fstack-usage. Entry points are the functions with a frame size that
+ * nothing calls: main and the interrupt handlers. Interrupts do not nest
+ * in these projects, so the worst case for the image is main plus the
+ * deepest handler.
+ *
+ * A '?' after a path marks a function without a .su record (libgcc or
+ * libm) or an indirect call; those count as 0 bytes, so the figure is a
+ * lower bound. A '!' marks recursion, which is not followed.
+ *
+ * Usage: msp430-elf-objdump -d app.elf | stack_depth app.su lib/digits.su ...
+ *
+ ***************************************************************************/
+
+#define MAX_FUNCS       512
+#define MAX_CALLS       2048
+#define NAME_SIZE       64
+#define LINE_SIZE       512
+#define RETURN_BYTES    2           // pushed by call
+#define INTERRUPT_BYTES 4           // PC and SR pushed on interrupt entry
+
+struct Func
+{
+    char name[NAME_SIZE];
+    unsigned long addr;
+    int frame;                      // bytes from the .su file, -1 if none
+    int called;
+    int state;                      // 0 new, 1 on the current path, 2 done
+    int depth;                      // worst case including callees
+    int next;                       // deepest callee, -1 if none
+    int flags;
+};
+
+#define FLAG_UNKNOWN    1
+#define FLAG_RECURSIVE  2
+
+static struct Func Funcs[MAX_FUNCS];
+static int FuncCount = 0;
+static int CallFrom[MAX_CALLS], CallTo[MAX_CALLS];
+static unsigned long CallAddr[MAX_CALLS];
+static char CallName[MAX_CALLS][NAME_SIZE];
+static int CallCount = 0;
+
+/* Function Prototypes */
+int findName(const char*);
+int findAddr(unsigned long);
+void readDisassembly(FILE*);
+int readStackUsage(const char*);
+void parseCall(int, const char*);
+int depth(int);
+void printPath(int);
+
+int main(int argc, char *argv[])
+{
+    int i, worstMain = -1, worstIsr = -1;
+
+    if (argc < 2){
+        fprintf(stderr, "usage: objdump -d app.elf | stack_depth file.su...\n");
+        return 1;
+    }
+
+    readDisassembly(stdin);
+    for (i=1; i<argc; i++){
+        if (readStackUsage(argv[i])){
+            return 1;
+        }
+    }
+
+    for (i=0; i<CallCount; i++){                    // resolve call targets
+        CallTo[i] = CallName[i][0] ? findName(CallName[i]) : findAddr(CallAddr[i]);
+        if (CallTo[i] >= 0){
+            Funcs[CallTo[i]].called = 1;
+        }
+        else{
+            Funcs[CallFrom[i]].flags |= FLAG_UNKNOWN;
+        }
+    }
+
+    for (i=0; i<FuncCount; i++){
+        int entry;
+
+        if (Funcs[i].called || Funcs[i].frame < 0){
+            continue;
+        }
+        entry = strcmp(Funcs[i].name, "main") ? INTERRUPT_BYTES : RETURN_BYTES;
+        printf("%5d  ", entry + depth(i));
+        printPath(i);
+
+        if (entry == RETURN_BYTES){
+            if (worstMain < 0 || Funcs[i].depth > Funcs[worstMain].depth){
+                worstMain = i;
+            }
+        }
+        else if (worstIsr < 0 || Funcs[i].depth > Funcs[worstIsr].depth){
+            worstIsr = i;
+        }
+    }
+
+    if (worstMain >= 0){
+        int total = RETURN_BYTES + Funcs[worstMain].depth;
+
+        printf("worst case: main %d", total);
+        if (worstIsr >= 0){
+            printf(" + %s %d", Funcs[worstIsr].name, INTERRUPT_BYTES + Funcs[worstIsr].depth);
+            total += INTERRUPT_BYTES + Funcs[worstIsr].depth;
+        }
+        printf(" = %d bytes\n", total);
+    }
+    return 0;
+}
+
+int findName(const char *name)
+{
+    int i;
+
+    for (i=0; i<FuncCount; i++){
+        if (!strcmp(Funcs[i].name, name)){
+            return i;
+        }
+    }
+    return -1;
+}
+
+int findAddr(unsigned long addr)
+{
+    int i;
+
+    for (i=0; i<FuncCount; i++){
+        if (Funcs[i].addr == addr){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Function:  readDisassembly
+ * ----------------------
+ * Collects every function label and the calls made from inside it.
+ */
+void readDisassembly(FILE *in)
+{
+    char line[LINE_SIZE];
+    int current = -1;
+
+    while (fgets(line, sizeof(line), in)){
+        unsigned long addr;
+        char name[NAME_SIZE];
+
+        if (sscanf(line, "%lx <%63[^>]>:", &addr, name) == 2){
+            if (FuncCount >= MAX_FUNCS){
+                fprintf(stderr, "more than %d functions\n", MAX_FUNCS);
+                exit(1);
+            }
+            current = FuncCount++;
+            strcpy(Funcs[current].name, name);
+            Funcs[current].addr = addr;
+            Funcs[current].frame = -1;
+            Funcs[current].next = -1;
+        }
+        else if (current >= 0){
+            parseCall(current, line);
+        }
+    }
+}
+
+/*
+ * Function:  parseCall
+ * ----------------------
+ * Records a call found in one disassembly line. The target is taken
+ * from a <symbol> annotation when objdump gives one, otherwise from the
+ * msp430 immediate "#0x..." comment or the "#decimal" operand. A call
+ * through a register is remembered as unresolved. A branch to an
+ * immediate counts as a call, gcc uses it for tail calls.
+ */
+void parseCall(int from, const char *line)
+{
+    const char *op = strstr(line, "\tcall");
+    const char *p;
+
+    if (op == NULL){
+        op = strstr(line, "\tbr\t#");
+        if (op == NULL){
+            return;
+        }
+    }
+    if (CallCount >= MAX_CALLS){
+        fprintf(stderr, "more than %d calls\n", MAX_CALLS);
+        exit(1);
+    }
+
+    CallFrom[CallCount] = from;
+    CallName[CallCount][0] = '\0';
+    CallAddr[CallCount] = (unsigned long)-1;
+
+    if ((p = strchr(op, '<')) != NULL){
+        sscanf(p, "<%63[^>+]", CallName[CallCount]);
+    }
+    else if ((p = strstr(op, "#0x")) != NULL){
+        CallAddr[CallCount] = strtoul(p + 3, NULL, 16);
+    }
+    else if ((p = strchr(op, '#')) != NULL){
+        CallAddr[CallCount] = strtol(p + 1, NULL, 10) & 0xFFFF;
+    }
+    else if (op[1] == 'b'){
+        return;                                     // computed branch inside a function
+    }
+    CallCount++;
+}
+
+/*
+ * Function:  readStackUsage
+ * ----------------------
+ * Reads one .su file, lines are "file:line:column:name<TAB>bytes<TAB>kind".
+ *
+ * returns: 0 on success
+ */
+int readStackUsage(const char *path)
+{
+    FILE *su = fopen(path, "r");
+    char line[LINE_SIZE];
+
+    if (su == NULL){
+        perror(path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), su)){
+        char *tab = strchr(line, '\t');
+        char *name;
+        int i;
+
+        if (tab == NULL){
+            continue;
+        }
+        *tab = '\0';
+        name = strrchr(line, ':');
+        name = name ? name + 1 : line;
+        i = findName(name);
+        if (i >= 0){
+            Funcs[i].frame = atoi(tab + 1);
+        }
+    }
+    fclose(su);
+    return 0;
+}
+
+/*
+ * Function:  depth
+ * ----------------------
+ * Worst case stack bytes of a function and everything it calls, not
+ * counting the return address pushed by its own caller.
+ */
+int depth(int f)
+{
+    struct Func *func = &Funcs[f];
+    int i;
+
+    if (func->state == 2){
+        return func->depth;
+    }
+    if (func->state == 1){
+        return 0;                                   // caller is flagged recursive
+    }
+    func->state = 1;
+    func->depth = func->frame;
+    if (func->frame < 0){
+        func->depth = 0;
+        func->flags |= FLAG_UNKNOWN;
+    }
+
+    for (i=0; i<CallCount; i++){
+        int callee = CallTo[i];
+        int d;
+
+        if (CallFrom[i] != f || callee < 0){
+            continue;
+        }
+        if (Funcs[callee].state == 1){
+            func->flags |= FLAG_RECURSIVE;
+            continue;
+        }
+        d = (func->frame < 0 ? 0 : func->frame) + RETURN_BYTES + depth(callee);
+        func->flags |= Funcs[callee].flags;
+        if (d > func->depth){
+            func->depth = d;
+            func->next = callee;
+        }
+    }
+    func->state = 2;
+    return func->depth;
+}
+
+/*
+ * Function:  printPath
+ * ----------------------
+ * Prints the deepest call chain from f with the frame size of each step
+ * and the marks collected anywhere below f.
+ */
+void printPath(int f)
+{
+    int flags = Funcs[f].flags;
+
+    while (f >= 0){
+        printf("%s(%d)", Funcs[f].name, Funcs[f].frame < 0 ? 0 : Funcs[f].frame);
+        f = Funcs[f].next;
+        if (f >= 0){
+            printf(" > ");
+        }
+    }
+    printf("%s%s\n", (flags & FLAG_UNKNOWN) ? " ?" : "", (flags & FLAG_RECURSIVE) ? " !" : "");
+}
@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "lib/frame.h"
+
+/***************************************************************************
+ * telemetry_gateway.c
+ * Host tool for level_and_distance_sensor.c
+ *
+ * Logs every frame the sensor MCU sends. Reads the sensor UART from a
+ * serial device (or a pseudo-terminal when testing), runs the same
+ * receive state machine as the display MCU, and writes one timestamped
+ * CSV record per frame to rotating log files and to every client of a
+ * local UNIX stream socket. Memory use is fixed: one read buffer, one
+ * batch of record lines per read and at most MAX_CLIENTS sockets of
+ * CLIENT_BUF each. A client that cannot keep up is disconnected instead
+ * of being buffered for.
+ *
+ * Usage: telemetry_gateway [-b baud] [-o prefix] [-n records] [-k files]
+ *                          [-s socket] device
+ *   -b  serial baud rate when device is a tty (default 9600)
+ *   -o  log file prefix, files are prefix.0.csv (newest) to prefix.k-1.csv
+ *   -n  records per log file before rotating (default 100000), when the
+ *       next file cannot be created the current one grows and every
+ *       record retries the rotation
+ *   -k  log files kept (default 4)
+ *   -s  UNIX socket path for live clients (default none)
+ *
+ ***************************************************************************/
+
+#define READ_SIZE       4096
+#define LINE_SIZE       96
+#define BATCH_SIZE      (16 * 1024)     // record lines sent to clients in one write
+#define MAX_CLIENTS     8
+#define CLIENT_BUF      (256 * 1024)    // socket send buffer that absorbs a client's stall
+#define PATH_SIZE       256
+
+/* Receive state, as USCI0RX_ISR() on the display MCU */
+static char RxBuffer[FRAME_SIZE];
+static struct FrameRx Rx;
+static int LastSeq = -1;
+
+/* Outputs */
+static FILE *Log = NULL;
+static const char *LogPrefix = NULL;
+static unsigned long LogRecords = 0, LogLimit = 100000;
+static int LogKeep = 4;
+static int LogStuck = 0;                // a rotation failed, retrying
+static int Listener = -1;
+static int Clients[MAX_CLIENTS];
+static char Batch[BATCH_SIZE];
+static size_t BatchLen = 0;
+
+static volatile sig_atomic_t Running = 1;
+
+/* Function Prototypes */
+int openDevice(const char*, unsigned long);
+int openListener(const char*);
+int rxByte(unsigned char);
+void emitFrame(void);
+int logRotate(void);
+void clientsAccept(void);
+void clientsSend(void);
+void onSignal(int);
+
+int main(int argc, char *argv[])
+{
+    const char *device = NULL, *sockPath = NULL;
+    unsigned long baud = 9600;
+    unsigned long frames = 0, bytes = 0;
+    unsigned char buf[READ_SIZE];
+    struct pollfd fds[2];
+    int fd, i;
+
+    for (i=1; i<argc; i++){
+        if (!strcmp(argv[i], "-b") && i+1 < argc){
+            baud = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-o") && i+1 < argc){
+            LogPrefix = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-n") && i+1 < argc){
+            LogLimit = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-k") && i+1 < argc){
+            LogKeep = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-s") && i+1 < argc){
+            sockPath = argv[++i];
+        }
+        else{
+            device = argv[i];
+        }
+    }
+    if (device == NULL || LogLimit == 0 || LogKeep < 1){
+        fprintf(stderr, "usage: telemetry_gateway [-b baud] [-o prefix] [-n records] [-k files] [-s socket] device\n");
+        return 1;
+    }
+
+    for (i=0; i<MAX_CLIENTS; i++){
+        Clients[i] = -1;
+    }
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    fd = openDevice(device, baud);
+    if (fd < 0){
+        return 1;
+    }
+    if (LogPrefix != NULL && logRotate() < 0){
+        return 1;
+    }
+    if (sockPath != NULL && (Listener = openListener(sockPath)) < 0){
+        return 1;
+    }
+
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = Listener;
+    fds[1].events = POLLIN;
+
+    while (Running){
+        ssize_t n;
+
+        if (poll(fds, (Listener >= 0) ? 2 : 1, -1) < 0){
+            if (errno == EINTR){continue;}
+            perror("poll");
+            break;
+        }
+        if ((Listener >= 0) && (fds[1].revents & POLLIN)){
+            clientsAccept();
+        }
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))){
+            continue;
+        }
+
+        n = read(fd, buf, sizeof(buf));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)){continue;}
+        if (n <= 0){
+            if (n < 0){perror(device);}
+            break;                                      // device closed
+        }
+
+        bytes += n;
+        for (i=0; i<n; i++){
+            if (rxByte(buf[i])){
+                emitFrame();
+                frames++;
+            }
+        }
+        if (Log != NULL){fflush(Log);}                 // one write per read burst
+        clientsSend();
+    }
+
+    fprintf(stderr, "%lu bytes, %lu frames\n", bytes, frames);
+    if (Log != NULL){fclose(Log);}
+    for (i=0; i<MAX_CLIENTS; i++){
+        if (Clients[i] >= 0){close(Clients[i]);}
+    }
+    if (Listener >= 0){
+        close(Listener);
+        unlink(sockPath);
+    }
+    close(fd);
+    return 0;
+}
+
+/*
+ * Function:  openDevice
+ * ----------------------
+ * Opens the sensor stream. A tty is switched to raw 8N1 at the given
+ * baud rate; a pseudo-terminal or plain file is read as is.
+ *
+ * returns: file descriptor, or -1 on error
+ */
+int openDevice(const char *path, unsigned long baud)
+{
+    static const struct {unsigned long rate; speed_t code;} Rates[] = {
+        {9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200}
+    };
+    struct termios tio;
+    unsigned int i;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0){
+        perror(path);
+        return -1;
+    }
+    if (!isatty(fd)){
+        return fd;
+    }
+
+    for (i=0; i<sizeof(Rates)/sizeof(Rates[0]); i++){
+        if (Rates[i].rate == baud){break;}
+    }
+    if (i == sizeof(Rates)/sizeof(Rates[0])){
+        fprintf(stderr, "unsupported baud rate %lu\n", baud);
+        close(fd);
+        return -1;
+    }
+    if (tcgetattr(fd, &tio) < 0){
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, Rates[i].code);
+    cfsetospeed(&tio, Rates[i].code);
+    if (tcsetattr(fd, TCSANOW, &tio) < 0){
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Function:  openListener
+ * ----------------------
+ * Creates the non-blocking UNIX stream socket live clients connect to.
+ *
+ * returns: socket, or -1 on error
+ */
+int openListener(const char *path)
+{
+    struct sockaddr_un addr;
+    int s;
+
+    if (strlen(path) >= sizeof(addr.sun_path)){
+        fprintf(stderr, "socket path too long\n");
+        return -1;
+    }
+    s = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (s < 0){
+        perror("socket");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(s, MAX_CLIENTS) < 0){
+        perror(path);
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+/*
+ * Function:  rxByte
+ * ----------------------
+ * USCI0RX_ISR() of the display MCU. Short and overrun frames are
+ * dropped, which also skips command answers and diagnostic lines.
+ *
+ * returns: 1 when RxBuffer holds a complete frame
+ */
+int rxByte(unsigned char byte)
+{
+    return frameRx(&Rx, RxBuffer, byte) == FRAME_DONE;
+}
+
+/*
+ * Function:  emitFrame
+ * ----------------------
+ * Formats the received frame as
+ *   time,seq,mode,value,x,y,gap
+ * with the fields of the mode filled in and the others left empty:
+ *   ANGLE       x and y, the signed X and Y tilt in degrees
+ *   CAL         value, the calibration positions captured so far
+ *   otherwise   value, d3..d0 as a number
+ * A frame whose places are not all digits logs value -1 whatever its
+ * mode. gap is the number of sequence values skipped since the previous
+ * frame.
+ */
+void emitFrame(void)
+{
+    char line[LINE_SIZE], fields[LINE_SIZE / 2];
+    struct timespec now;
+    long value = frameValue(RxBuffer);
+    int seq = frameSequence(RxBuffer);
+    int gap = 0, len;
+
+    if (seq >= 0){
+        if (LastSeq >= 0){
+            gap = (seq - LastSeq - 1) & (SEQ_COUNT - 1);
+        }
+        LastSeq = seq;
+    }
+
+    if (value < 0){
+        snprintf(fields, sizeof(fields), "-1,,");
+    }
+    else if (RxBuffer[FRAME_MODE] == MODE_ANGLE){
+        snprintf(fields, sizeof(fields), ",%d,%d", frameTilt(RxBuffer, SIGN_X), frameTilt(RxBuffer, SIGN_Y));
+    }
+    else if (RxBuffer[FRAME_MODE] == MODE_CAL){
+        snprintf(fields, sizeof(fields), "%d,,", RxBuffer[0] - '0');     // display shows d0 after CAL
+    }
+    else{
+        snprintf(fields, sizeof(fields), "%ld,,", value);
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    len = snprintf(line, sizeof(line), "%ld.%03ld,%d,%c,%s,%d\n", (long)now.tv_sec, now.tv_nsec / 1000000L,
+            seq, (RxBuffer[FRAME_MODE] > ' ' && RxBuffer[FRAME_MODE] < 0x7F) ? RxBuffer[FRAME_MODE] : '?', fields, gap);
+
+    if (Log != NULL){
+        fputs(line, Log);
+        if (++LogRecords >= LogLimit){
+            logRotate();                                // on failure the next record retries
+        }
+    }
+    if (BatchLen + len > sizeof(Batch)){
+        clientsSend();
+    }
+    memcpy(Batch + BatchLen, line, len);
+    BatchLen += len;
+}
+
+/*
+ * Function:  logRotate
+ * ----------------------
+ * Starts a new prefix.0.csv with a header line, shifting prefix.i.csv to
+ * prefix.i+1.csv and dropping the oldest. The new file is created before
+ * the current one is closed, so when that fails the current log stays
+ * open and records keep going to it. The error is reported once and the
+ * recovery when a later call succeeds.
+ *
+ * returns: 0, or -1 when the new file cannot be created
+ */
+int logRotate(void)
+{
+    char from[PATH_SIZE], to[PATH_SIZE], next[PATH_SIZE];
+    FILE *file;
+    int i;
+
+    snprintf(next, sizeof(next), "%s.next.csv", LogPrefix);
+    file = fopen(next, "w");
+    if (file == NULL){
+        if (!LogStuck){perror(next);}
+        LogStuck = 1;
+        return -1;
+    }
+    fputs("time,seq,mode,value,x,y,gap\n", file);
+
+    if (Log != NULL){
+        fclose(Log);
+    }
+    for (i=LogKeep-1; i>0; i--){
+        snprintf(from, sizeof(from), "%s.%d.csv", LogPrefix, i - 1);
+        snprintf(to, sizeof(to), "%s.%d.csv", LogPrefix, i);
+        rename(from, to);                               // missing files are fine
+    }
+    snprintf(to, sizeof(to), "%s.0.csv", LogPrefix);
+    if (rename(next, to) < 0){
+        perror(to);                                     // still logging, under the .next name
+    }
+    if (LogStuck){
+        fprintf(stderr, "%s: log rotated after %lu records\n", to, LogRecords);
+        LogStuck = 0;
+    }
+
+    Log = file;
+    LogRecords = 0;
+    return 0;
+}
+
+/*
+ * Function:  clientsAccept
+ * ----------------------
+ * Takes every pending connection while a client slot is free. Extra
+ * connections are closed right away.
+ */
+void clientsAccept(void)
+{
+    int size = CLIENT_BUF;
+    int c, i;
+
+    while ((c = accept(Listener, NULL, NULL)) >= 0){
+        for (i=0; i<MAX_CLIENTS; i++){
+            if (Clients[i] < 0){
+                Clients[i] = c;
+                fcntl(c, F_SETFL, O_NONBLOCK);
+                setsockopt(c, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+                break;
+            }
+        }
+        if (i == MAX_CLIENTS){
+            close(c);
+        }
+    }
+}
+
+/*
+ * Function:  clientsSend
+ * ----------------------
+ * Writes the batched record lines to every client and empties the
+ * batch. A client whose socket buffer is full or closed is disconnected
+ * rather than queued for.
+ */
+void clientsSend(void)
+{
+    int i;
+
+    for (i=0; i<MAX_CLIENTS && BatchLen > 0; i++){
+        if (Clients[i] >= 0 && send(Clients[i], Batch, BatchLen, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)BatchLen){
+            close(Clients[i]);
+            Clients[i] = -1;
+        }
+    }
+    BatchLen = 0;
+}
+
+void onSignal(int sig)
+{
+    (void)sig;
+    Running = 0;
+}
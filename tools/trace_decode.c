@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/***************************************************************************
+ * trace_decode.c
+ * Host tool for level_and_distance_sensor.c
+ *
+ * Decodes trace dumps captured from the sensor MCU UART into a CSV
+ * timeline. A dump is a "!TR" text line of hex digits ended by ';'. A
+ * capture may hold several dumps mixed with normal display frames;
+ * anything that is not a valid dump is skipped. Times restart at zero
+ * with the oldest record of each dump.
+ *
+ * Usage: trace_decode [capture.bin] > trace.csv
+ *
+ ***************************************************************************/
+
+#define TRACE_VERSION   2           // must match level_and_distance_sensor.c
+#define RECORD_SIZE     6
+#define TICK_US         256         // one timestamp count in microseconds
+
+/* Event names, indexed by TraceEvents id in level_and_distance_sensor.c */
+static const char *const EventNames[] = {
+    "none", "echo", "distance", "level", "frame", "button"
+};
+
+/* Function Prototypes */
+int readHex(FILE*);
+int readDump(FILE*, int);
+void printRecord(int, const unsigned char*, unsigned long*, unsigned int*);
+
+int main(int argc, char *argv[])
+{
+    FILE *in = stdin;
+    int c, prev = EOF;
+    int dumps = 0;
+
+    if (argc > 1){
+        in = fopen(argv[1], "rb");
+        if (in == NULL){
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    printf("dump,time_us,event,arg,value\n");
+
+    while ((c = fgetc(in)) != EOF){
+        if ((prev == 'T') && (c == 'R')){          // dump header
+            if (readDump(in, dumps)){
+                dumps++;
+            }
+            c = EOF;
+        }
+        prev = c;
+    }
+
+    fprintf(stderr, "%d dump(s) decoded\n", dumps);
+    if (in != stdin){fclose(in);}
+    return 0;
+}
+
+/*
+ * Function:  readHex
+ * ----------------------
+ * Reads one byte sent as two hex digits.
+ *
+ * returns: the byte, EOF at the end of the input or on anything else
+ */
+int readHex(FILE *in)
+{
+    int digit[2], i, c;
+
+    for (i=0; i<2; i++){
+        c = fgetc(in);
+        if (c >= '0' && c <= '9'){digit[i] = c - '0';}
+        else if (c >= 'A' && c <= 'F'){digit[i] = c - 'A' + 10;}
+        else{return EOF;}
+    }
+    return (digit[0] << 4) | digit[1];
+}
+
+/*
+ * Function:  readDump
+ * ----------------------
+ * Reads the version, count, records and checksum following a 'T' 'R'
+ * header and prints the records when the checksum matches and the
+ * line ends with ';'.
+ *
+ * returns: 1 when a dump was decoded, 0 otherwise
+ */
+int readDump(FILE *in, int dump)
+{
+    unsigned char buf[255 * RECORD_SIZE];
+    unsigned char check = 0;
+    unsigned long time = 0;
+    unsigned int prevTick;
+    int version = readHex(in);
+    int count = readHex(in);
+    int sum, c;
+    unsigned int i;
+
+    if ((version != TRACE_VERSION) || (count == EOF)){
+        return 0;
+    }
+    for (i=0; i < (unsigned int)count * RECORD_SIZE; i++){
+        if ((c = readHex(in)) == EOF){
+            return 0;
+        }
+        buf[i] = c;
+        check ^= c;
+    }
+    sum = readHex(in);
+    if (fgetc(in) != ';'){
+        return 0;
+    }
+    if (sum != check){
+        fprintf(stderr, "dump of %d records failed checksum\n", count);
+        return 0;
+    }
+
+    prevTick = buf[0] | (buf[1] << 8);              // timeline starts at the oldest record
+    for (i=0; i < (unsigned int)count; i++){
+        printRecord(dump, &buf[i * RECORD_SIZE], &time, &prevTick);
+    }
+    return 1;
+}
+
+/*
+ * Function:  printRecord
+ * ----------------------
+ * Prints one record as a CSV line. The 16-bit timestamp is unwrapped
+ * against the previous record, so a timeline stays monotonic as long
+ * as records are less than 16.7s apart.
+ */
+void printRecord(int dump, const unsigned char *rec, unsigned long *time, unsigned int *prevTick)
+{
+    unsigned int tick = rec[0] | (rec[1] << 8);
+    unsigned int id = rec[2];
+    unsigned int arg = rec[3];
+    unsigned int value = rec[4] | (rec[5] << 8);
+
+    *time += ((tick - *prevTick) & 0xFFFF) * (unsigned long)TICK_US;
+    *prevTick = tick;
+
+    if (id < sizeof(EventNames) / sizeof(EventNames[0])){
+        printf("%d,%lu,%s,%u,%u\n", dump, *time, EventNames[id], arg, value);
+    }
+    else{
+        printf("%d,%lu,%u,%u,%u\n", dump, *time, id, arg, value);
+    }
+}
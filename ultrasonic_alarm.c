@@ -1,6 +1,11 @@
 #include <msp430.h> 
 #include <stdio.h>
 #include <stdlib.h>
+#include "lib/digits.h"
+#include "lib/display.h"
+#include "lib/link.h"
+#include "lib/uart.h"
+#include "lib/watchdog.h"
 
 /***************************************************************************
  * adc_ultrasonic_sensor.c
@@ -15,20 +20,15 @@
  *
  ***************************************************************************/
 
-/* Define 7-seg to hex values, use not operator if display is common anode*/
-#define ZERO    (~0x7E)
-#define ONE     (~0x30)
-#define TWO     (~0x6D)
-#define THREE   (~0x79)
-#define FOUR    (~0x33)
-#define FIVE    (~0x5B)
-#define SIX     (~0x5F)
-#define SEVEN   (~0x70)
-#define EIGHT   (~0x7F)
-#define NINE    (~0x7B)
 #define ECHO_P  (BIT1)
 #define TRIG_P  (BIT0)
 
+/* Watchdog heartbeats, fed only once every task of the role checked in */
+#define BEAT_MEASURE    BIT0        // MCU0: distance measured
+#define BEAT_OUTPUT     BIT1        // MCU0: frame handed to the UART
+#define BEAT_RX         BIT2        // MCU1: receive path armed or frame waiting
+#define BEAT_DISPLAY    BIT3        // MCU1: display refreshed
+
 /* Global variables */
 volatile unsigned int Start;
 volatile unsigned int End;
@@ -37,8 +37,6 @@ volatile unsigned int Distance = 0;
 volatile unsigned int Level = 0;
 volatile unsigned int Counting = 0;
 volatile unsigned int Edge = 0;
-static char TxBuffer[5], RxBuffer[5], Digits[5];
-unsigned int TxBufIndex = 0, RxBufIndex = 0;
 volatile unsigned int data[10];
 static unsigned int val = 0;
 enum Flags {STOP, SET, SAVE};
@@ -51,10 +49,7 @@ void portInit1(void);
 void setSpeaker(void);
 void setDistance(int);
 void convertSensor(int);
-void transmit(void);
-void receive(void);
 void display(void);
-void displayDigit(char);
 void triggerSensor(void);
 
 int main(void)
@@ -66,10 +61,13 @@ int main(void)
 
         while(1){
             triggerSensor();                                // Capture ultrasonic measurements
+            HEARTBEAT(BEAT_MEASURE);
             convertSensor(Distance);                        // Convert sensor value into char
             setDistance(Distance);                          // Sets distance based off of sensor value
             setSpeaker();                                   // Sets speaker output
-            transmit();                                     // Send converted char's through UART
+            linkSend();                                     // Send converted char's through UART
+            HEARTBEAT(BEAT_OUTPUT);
+            supervise(BEAT_MEASURE + BEAT_OUTPUT);
             __delay_cycles(100000);                         // Sample every 200ms or 5Hz frequency
 
         }
@@ -80,13 +78,17 @@ int main(void)
 
         while(1){
             if (Flag == SAVE){
-                receive();
-                IE2 |= UCA0RXIE;                            // Enable USCI_A0 RX interrupt
+                linkReceive();                              // show the frame, RX interrupt enabled again
                 Flag = STOP;
             }
             else{
                 display();                                  // Display the distance value
+                HEARTBEAT(BEAT_DISPLAY);
+            }
+            if ((IE2 & UCA0RXIE) || (Flag == SAVE)){
+                HEARTBEAT(BEAT_RX);                         // not stuck with RX disabled and nothing to save
             }
+            supervise(BEAT_RX + BEAT_DISPLAY);
         }
     }
 }
@@ -146,37 +148,13 @@ void triggerSensor(void)
 /*
  * Function: convertSensor
  * ---------------------
- * Receives the sampled ultrasonic sensor value and splits it
- * into digit places using modulo division.
- * Based off position place a key is created.
- * Values stored into global array.
+ * Encodes the sampled ultrasonic sensor value into the frame to send,
+ * display() blanks the leading zeros.
 */
 void convertSensor(int readVal)
 {
-    unsigned int key = 0;
-
-    if (readVal > 99){                      // Capture 100s place
-        key = 3;
-    }
-    else if (readVal > 9){                  // Capture 10s place
-        key = 2;
-    }
-    else{
-        key = 1;
-    }
-
-    Digits[0] = (readVal % 10) + 48;
-    readVal /= 10;
-
-    Digits[1] = (readVal % 10) + 48;
-    readVal /= 10;
-
-    Digits[2] = (readVal % 10) + 48;
-
-    Digits[3] = key + 48;
-
-    Digits[4] = 44;                         // add , as stop flag
-
+    frameEncode(Digits, readVal);
+    Digits[FRAME_MODE] = MODE_DISTANCE;
 }
 
 /*
@@ -251,188 +229,28 @@ void setSpeaker()
     }
 }
 
-/*
- * Function:  transmit
- * ----------------------
- * Transfers converted ADC data to Tx buffer and begins transmission
- */
-void transmit()
-{
-    unsigned int i;
-    for (i=0; i < sizeof(TxBuffer); i++)
-    {
-        TxBuffer[i] = Digits[i];
-    }
-    TxBufIndex = 0;
-    IE2 |= UCA0TXIE;        // Enable USCI_A0 TX interrupt to begin UART transmission
-}
-
-// UART TX ISR to transmit data
-#pragma vector = USCIAB0TX_VECTOR
-__interrupt void USCI0TX_ISR(void)
-{
-    UCA0TXBUF = TxBuffer[TxBufIndex];
-    TxBufIndex++;                           // Transmit next character
-
-    if (TxBufIndex >= sizeof(TxBuffer)){    // Check if TX has been completed
-        TxBufIndex = 0;
-        IE2 &= ~UCA0TXIE;                   // Disable USCI_A0 TX interrupt
-    }
-}
-
 // UART RX ISR to receive data
 #pragma vector = USCIAB0RX_VECTOR
 __interrupt void USCI0RX_ISR(void)
 {
-    if (RxBufIndex < sizeof(Digits))
-    {
-        if (UCA0RXBUF == ','){
-            RxBufIndex = 0;
-            Flag = SAVE;
-            IE2 &= ~UCA0RXIE;               // Disable USCI_A0 RX interrupt
-        }
-        else{
-            RxBuffer[RxBufIndex] = UCA0RXBUF;
-            RxBufIndex++;
-        }
-    }
-    else{
-        RxBufIndex = 0;
-    }
-}
-
-/*
- * Function:  receive
- * ----------------------
- * Stores received UART data from buffer into an array
- */
-void receive()
-{
-    unsigned int i;
-    for(i=0; i < sizeof(Digits); i++)
-    {
-        Digits[i] = RxBuffer[i];
+    if (linkRx(UCA0RXBUF) == FRAME_DONE){
+        Flag = SAVE;                        // RX interrupt stays off until linkReceive()
     }
 }
 
 /*
  * Function:  display
  * ----------------------
- * Enables and starts ADC conversion.
- * Return sampled value from ADC10MEM Register.
- *
- * returns: int value between 0-1023
+ * Multiplexes one pass over the four places with displayScan(),
+ * leading zero places stay dark.
  */
 void display(void)
 {
     // use P2.0 - P2.7 for digit display
-    // use P1.0 - P1.3 for place selection
-    char keyVal;
-    keyVal = Digits[3];
-
-    switch(keyVal) {
-
-    case '1':
-        P1OUT = BIT5;                   // Set digit position on
-        displayDigit(Digits[0]);        // Display number
-        __delay_cycles(4000);
-        break;
-
-    case '2':
-        P1OUT = BIT5;
-        displayDigit(Digits[0]);
-        __delay_cycles(4000);
-        P1OUT = BIT4;
-        displayDigit(Digits[1]);
-        __delay_cycles(4000);
-        break;
-
-    case '3':
-        P1OUT = BIT5;
-        displayDigit(Digits[0]);
-        __delay_cycles(4000);
-        P1OUT = BIT4;
-        displayDigit(Digits[1]);
-        __delay_cycles(4000);
-        P1OUT = BIT7;
-        displayDigit(Digits[2]);
-        __delay_cycles(4000);
-        break;
-
-    case '4':
-        P1OUT = BIT5;
-        displayDigit(Digits[0]);
-        __delay_cycles(2000);
-        P1OUT = BIT4;
-        displayDigit(Digits[1]);
-        __delay_cycles(2000);
-        P1OUT = BIT7;
-        displayDigit(Digits[2]);
-        __delay_cycles(2000);
-        P1OUT = BIT6;
-        displayDigit(Digits[3]);
-        __delay_cycles(4000);
-        break;
-
-    default:
-        P1OUT = 0x00;
-    }
-}
-
-/*
- * Function: displayDigit
- * --------------------
- * Based on the passed int value, assign output port P2.0-P2.6
- * to display the corresponding number
- *
- * returns: void
- */
-void displayDigit(char val)
-{
-    switch(val) {                   // Use char to select display bit value
-    case '0':
-        P2OUT = ZERO;               // Set pins to display value
-        break;
+    // use P1.4 - P1.7 for place selection
+    static const unsigned char Place[DIGIT_COUNT] = {BIT5, BIT4, BIT7, BIT6};
 
-    case '1':
-        P2OUT = ONE;
-        break;
-
-    case '2':
-        P2OUT = TWO;
-        break;
-
-    case '3':
-        P2OUT = THREE;
-        break;
-
-    case '4':
-        P2OUT = FOUR;
-        break;
-
-    case '5':
-        P2OUT = FIVE;
-        break;
-
-    case '6':
-        P2OUT = SIX;
-        break;
-
-    case '7':
-        P2OUT = SEVEN;
-        break;
-
-    case '8':
-        P2OUT = EIGHT;
-        break;
-
-    case '9':
-        P2OUT = NINE;
-        break;
-
-    default:
-        P2OUT = ~0x00;
-    }
+    displayScan(Digits, Place);
 }
 
 /*
@@ -479,15 +297,12 @@ void portInit0(void)
     DCOCTL = 0;                                     // Select lowest DCOx and MODx settings
     BCSCTL1 = CALBC1_1MHZ;                          // Set DCO
     DCOCTL = CALDCO_1MHZ;
+    watchdogStart();                                // supervised from here on
 
     // Configure UART //
     P1SEL = BIT2;                                   // P1.2=TXD
     P1SEL2 = BIT2;                                  // P1.2=TXD
-    UCA0CTL1 |= UCSSEL_2;                           // SMCLK
-    UCA0BR0 = 104;                                  // 1MHz 9600
-    UCA0BR1 = 0;                                    // 1MHz 9600
-    UCA0MCTL = UCBRS0;                              // Modulation UCBRSx = 1
-    UCA0CTL1 &= ~UCSWRST;                           // **Initialize USCI state machine**
+    uartInit();                                     // SMCLK, 1MHz 9600
 
     // Set GPIO Pin //
     P1DIR |= BIT6;                                  // Set P1.6 as speaker driver
@@ -527,15 +342,12 @@ void portInit1(void)
     DCOCTL = 0;                                     // Select lowest DCOx and MODx settings
     BCSCTL1 = CALBC1_1MHZ;                          // Set DCO
     DCOCTL = CALDCO_1MHZ;
+    watchdogStart();                                // supervised from here on
 
     /* Configure UART */
     P1SEL = BIT1 + BIT2;                            // P1.1=RXD
     P1SEL2 = BIT1 + BIT2;                           // P1.1=RXD
-    UCA0CTL1 |= UCSSEL_2;                           // SMCLK
-    UCA0BR0 = 104;                                  // 1MHz 9600
-    UCA0BR1 = 0;                                    // 1MHz 9600
-    UCA0MCTL = UCBRS0;                              // Modulation UCBRSx = 1
-    UCA0CTL1 &= ~UCSWRST;                           // **Initialize USCI state machine**
+    uartInit();                                     // SMCLK, 1MHz 9600
     IE2 |= UCA0RXIE;                                // Enable USCI_A0 RX interrupt
 
     /* Configure GPIO */